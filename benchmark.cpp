@@ -0,0 +1,32 @@
+#include "timsort.h"
+#include "benchmark.h"
+#include <fstream>
+
+//usage: benchmark [output.json [repetitions [max size]]]
+int main(int argc, char **argv) {
+    BenchmarkConfig config;
+
+    if (argc > 2) {
+        config.repetitions = atoi(argv[2]);
+    }
+
+    if (argc > 3) {
+        size_t maxSize = strtoull(argv[3], 0, 10);
+        std::vector<size_t> sizes;
+        for (auto it = config.sizes.begin(); it != config.sizes.end(); ++it) {
+            if (*it <= maxSize) {
+                sizes.push_back(*it);
+            }
+        }
+        config.sizes = sizes;
+    }
+
+    if (argc > 1) {
+        std::ofstream output(argv[1]);
+        runBenchmarkSuite(output, config);
+    } else {
+        runBenchmarkSuite(std::cout, config);
+    }
+
+    return 0;
+}
@@ -0,0 +1,361 @@
+#pragma once
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "test_generator.h"
+
+enum EInputShape {
+    IS_RANDOM,
+    IS_SORTED,
+    IS_REVERSED,
+    IS_SAWTOOTH,
+    IS_ORGAN_PIPE,
+    IS_FEW_UNIQUE,
+    IS_SORTED_APPEND,
+    IS_PARTIALLY_SORTED_20,
+    IS_PARTIALLY_SORTED_1024
+};
+
+const EInputShape allInputShapes[] = {
+    IS_RANDOM,
+    IS_SORTED,
+    IS_REVERSED,
+    IS_SAWTOOTH,
+    IS_ORGAN_PIPE,
+    IS_FEW_UNIQUE,
+    IS_SORTED_APPEND,
+    IS_PARTIALLY_SORTED_20,
+    IS_PARTIALLY_SORTED_1024
+};
+
+const char* inputShapeName(EInputShape shape) {
+    switch (shape) {
+        case IS_RANDOM:
+            return "random";
+        case IS_SORTED:
+            return "sorted";
+        case IS_REVERSED:
+            return "reversed";
+        case IS_SAWTOOTH:
+            return "sawtooth";
+        case IS_ORGAN_PIPE:
+            return "organ_pipe";
+        case IS_FEW_UNIQUE:
+            return "few_unique";
+        case IS_SORTED_APPEND:
+            return "sorted_random_append";
+        case IS_PARTIALLY_SORTED_20:
+            return "partially_sorted_20";
+        case IS_PARTIALLY_SORTED_1024:
+            return "partially_sorted_1024";
+    }
+    return "";
+}
+
+template <class DataType>
+const char* dataTypeName();
+
+template <>
+const char* dataTypeName<int>() {
+    return "int";
+}
+
+template <>
+const char* dataTypeName<float>() {
+    return "float";
+}
+
+template <>
+const char* dataTypeName<Point3D>() {
+    return "Point3D";
+}
+
+template <>
+const char* dataTypeName<std::string>() {
+    return "string";
+}
+
+template <class DataType>
+void sortBlocksOf(std::vector<DataType> &data, size_t blockSize) {
+    for (size_t pointer = 0; pointer < data.size(); pointer += blockSize) {
+        std::sort(data.begin() + pointer, data.begin() + std::min(pointer + blockSize, data.size()),
+                LessCompare<DataType>());
+    }
+}
+
+template <class DataType>
+std::vector<DataType> generateShape(size_t size, EInputShape shape) {
+    RandomFactory<DataType> factory;
+    ui32 valueRange = (shape == IS_FEW_UNIQUE ? 16 : static_cast<ui32>(size) + 1);
+
+    std::vector<DataType> result(size);
+    for (size_t pointer = 0; pointer < size; ++pointer) {
+        result[pointer] = factory.generateObject(valueRange);
+    }
+
+    LessCompare<DataType> comp;
+    switch (shape) {
+        case IS_RANDOM:
+        case IS_FEW_UNIQUE:
+            break;
+        case IS_SORTED:
+            std::sort(result.begin(), result.end(), comp);
+            break;
+        case IS_REVERSED:
+            std::sort(result.begin(), result.end(), comp);
+            std::reverse(result.begin(), result.end());
+            break;
+        case IS_SAWTOOTH:
+            sortBlocksOf(result, size / 8 + 1);
+            break;
+        case IS_ORGAN_PIPE:
+            std::sort(result.begin(), result.end(), comp);
+            std::reverse(result.begin() + size / 2, result.end());
+            break;
+        case IS_SORTED_APPEND:
+            std::sort(result.begin(), result.end() - size / 100, comp);
+            break;
+        case IS_PARTIALLY_SORTED_20:
+            sortBlocksOf(result, 20);
+            break;
+        case IS_PARTIALLY_SORTED_1024:
+            sortBlocksOf(result, 1024);
+            break;
+    }
+
+    return result;
+}
+
+struct BenchmarkResult {
+    double median;
+    double p10;
+    double p90;
+    double min;
+    double max;
+};
+
+//nearest-rank percentile of sorted samples
+double percentile(const std::vector<double> &samples, double rank) {
+    size_t index = static_cast<size_t>(rank * (samples.size() - 1) + 0.5);
+    return samples[index];
+}
+
+//every repetition sorts a fresh copy of the same input; only the sort is timed
+template <class DataType, class SortFunction>
+BenchmarkResult measureSort(const std::vector<DataType> &input, ui32 repetitions, SortFunction sortFunction) {
+    std::vector<double> samples;
+
+    for (ui32 repetition = 0; repetition < repetitions; ++repetition) {
+        std::vector<DataType> data = input;
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        sortFunction(data.begin(), data.end());
+        std::chrono::steady_clock::time_point finish = std::chrono::steady_clock::now();
+
+        samples.push_back(std::chrono::duration<double, std::milli>(finish - start).count());
+    }
+
+    std::sort(samples.begin(), samples.end());
+
+    BenchmarkResult result;
+    result.median = percentile(samples, 0.5);
+    result.p10 = percentile(samples, 0.1);
+    result.p90 = percentile(samples, 0.9);
+    result.min = samples.front();
+    result.max = samples.back();
+    return result;
+}
+
+//the merge strategies are timed without the radix path, which would take over run-poor
+//arithmetic inputs and hide the differences between them
+template <class DataType>
+struct TimSortFunction {
+    template <class RandomAccessIterator>
+    void operator()(RandomAccessIterator begin, RandomAccessIterator end) {
+        timSort<NoRadixParams<>>(begin, end, LessCompare<DataType>());
+    }
+};
+
+//the default policy, radix path included
+template <class DataType>
+struct RadixTimSortFunction {
+    template <class RandomAccessIterator>
+    void operator()(RandomAccessIterator begin, RandomAccessIterator end) {
+        timSort(begin, end, LessCompare<DataType>());
+    }
+};
+
+template <class DataType>
+struct InplaceTimSortFunction {
+    template <class RandomAccessIterator>
+    void operator()(RandomAccessIterator begin, RandomAccessIterator end) {
+        timSort<InplaceParams>(begin, end, LessCompare<DataType>());
+    }
+};
+
+template <class DataType>
+struct StableInplaceTimSortFunction {
+    template <class RandomAccessIterator>
+    void operator()(RandomAccessIterator begin, RandomAccessIterator end) {
+        timSort<StableInplaceParams>(begin, end, LessCompare<DataType>());
+    }
+};
+
+template <class DataType>
+struct PowersortTimSortFunction {
+    template <class RandomAccessIterator>
+    void operator()(RandomAccessIterator begin, RandomAccessIterator end) {
+        timSort<NoRadixParams<PowersortParams>>(begin, end, LessCompare<DataType>());
+    }
+};
+
+template <class DataType>
+struct StableSortFunction {
+    template <class RandomAccessIterator>
+    void operator()(RandomAccessIterator begin, RandomAccessIterator end) {
+        std::stable_sort(begin, end, LessCompare<DataType>());
+    }
+};
+
+template <class DataType>
+struct StdSortFunction {
+    template <class RandomAccessIterator>
+    void operator()(RandomAccessIterator begin, RandomAccessIterator end) {
+        std::sort(begin, end, LessCompare<DataType>());
+    }
+};
+
+class BenchmarkReport {
+private:
+
+    std::ostream &output;
+    bool firstEntry;
+
+public:
+
+    explicit BenchmarkReport(std::ostream &output) : output(output), firstEntry(true) {
+        output << "{\n  \"benchmarks\": [";
+    }
+
+    void add(const char *dataType, const char *shape, size_t size, const char *algorithm,
+            ui32 repetitions, const BenchmarkResult &result) {
+        output << (firstEntry ? "\n" : ",\n");
+        firstEntry = false;
+
+        output << "    {\"type\": \"" << dataType << "\", \"shape\": \"" << shape <<
+            "\", \"size\": " << size << ", \"algorithm\": \"" << algorithm <<
+            "\", \"repetitions\": " << repetitions <<
+            ", \"median_ms\": " << result.median << ", \"p10_ms\": " << result.p10 <<
+            ", \"p90_ms\": " << result.p90 << ", \"min_ms\": " << result.min <<
+            ", \"max_ms\": " << result.max << "}";
+        output.flush();
+    }
+
+    void addCounters(const char *dataType, const char *shape, size_t size, const char *algorithm,
+            const TimSortStats &stats) {
+        output << (firstEntry ? "\n" : ",\n");
+        firstEntry = false;
+
+        output << "    {\"type\": \"" << dataType << "\", \"shape\": \"" << shape <<
+            "\", \"size\": " << size << ", \"algorithm\": \"" << algorithm <<
+            "\", \"comparisons\": " << stats.comparisons << ", \"moves\": " << stats.moves <<
+            ", \"runs\": " << stats.runs << ", \"gallop_skipped\": " << stats.gallopSkipped <<
+            ", \"radix_sorts\": " << stats.radixSorts << "}";
+        output.flush();
+    }
+
+    ~BenchmarkReport() {
+        output << "\n  ]\n}\n";
+    }
+};
+
+struct BenchmarkConfig {
+    std::vector<size_t> sizes;
+    ui32 repetitions;
+    ui32 seed;
+
+    BenchmarkConfig() : repetitions(9), seed(0451) {
+        sizes.push_back(1000);
+        sizes.push_back(100000);
+        sizes.push_back(1000000);
+    }
+};
+
+template <class DataType>
+void runTypeBenchmarks(BenchmarkReport &report, const BenchmarkConfig &config) {
+    for (auto size = config.sizes.begin(); size != config.sizes.end(); ++size) {
+        for (ui32 shapeIndex = 0; shapeIndex < sizeof(allInputShapes) / sizeof(allInputShapes[0]); ++shapeIndex) {
+            EInputShape shape = allInputShapes[shapeIndex];
+            const char *shapeName = inputShapeName(shape);
+
+            srand(config.seed);
+            std::vector<DataType> input = generateShape<DataType>(*size, shape);
+
+            report.add(dataTypeName<DataType>(), shapeName, *size, "timsort", config.repetitions,
+                    measureSort(input, config.repetitions, TimSortFunction<DataType>()));
+            report.add(dataTypeName<DataType>(), shapeName, *size, "timsort_radix", config.repetitions,
+                    measureSort(input, config.repetitions, RadixTimSortFunction<DataType>()));
+            report.add(dataTypeName<DataType>(), shapeName, *size, "timsort_inplace", config.repetitions,
+                    measureSort(input, config.repetitions, InplaceTimSortFunction<DataType>()));
+            report.add(dataTypeName<DataType>(), shapeName, *size, "timsort_stable_inplace", config.repetitions,
+                    measureSort(input, config.repetitions, StableInplaceTimSortFunction<DataType>()));
+            report.add(dataTypeName<DataType>(), shapeName, *size, "timsort_powersort", config.repetitions,
+                    measureSort(input, config.repetitions, PowersortTimSortFunction<DataType>()));
+            report.add(dataTypeName<DataType>(), shapeName, *size, "std::stable_sort", config.repetitions,
+                    measureSort(input, config.repetitions, StableSortFunction<DataType>()));
+            report.add(dataTypeName<DataType>(), shapeName, *size, "std::sort", config.repetitions,
+                    measureSort(input, config.repetitions, StdSortFunction<DataType>()));
+        }
+    }
+}
+
+template <class DataType, class Params>
+void addMergeCost(BenchmarkReport &report, const std::vector<DataType> &input, const char *shape,
+        const char *algorithm) {
+    std::vector<DataType> data = input;
+    TimSortStats stats;
+    timSort(data.begin(), data.end(), LessCompare<DataType>(), Params(), stats);
+    report.addCounters(dataTypeName<DataType>(), shape, data.size(), algorithm, stats);
+}
+
+//comparisons and moves do not depend on the machine, so one run per merge strategy is enough
+template <class DataType>
+void runMergeCostBenchmarks(BenchmarkReport &report, const BenchmarkConfig &config) {
+    for (auto size = config.sizes.begin(); size != config.sizes.end(); ++size) {
+        for (ui32 shapeIndex = 0; shapeIndex < sizeof(allInputShapes) / sizeof(allInputShapes[0]); ++shapeIndex) {
+            EInputShape shape = allInputShapes[shapeIndex];
+
+            srand(config.seed);
+            std::vector<DataType> input = generateShape<DataType>(*size, shape);
+
+            addMergeCost<DataType, NoRadixParams<DefaultParams>>(report, input, inputShapeName(shape), "timsort");
+            addMergeCost<DataType, NoRadixParams<PowersortParams>>(report, input, inputShapeName(shape),
+                    "timsort_powersort");
+            addMergeCost<DataType, InplaceParams>(report, input, inputShapeName(shape), "timsort_inplace");
+            addMergeCost<DataType, StableInplaceParams>(report, input, inputShapeName(shape),
+                    "timsort_stable_inplace");
+        }
+    }
+}
+
+//writes the whole matrix of element types, input shapes, sizes and algorithms as JSON,
+//followed by the merge cost of the merge strategies and the in-place merge modes
+void runBenchmarkSuite(std::ostream &output, const BenchmarkConfig &config = BenchmarkConfig()) {
+    BenchmarkReport report(output);
+
+    runTypeBenchmarks<int>(report, config);
+    runTypeBenchmarks<float>(report, config);
+    runTypeBenchmarks<Point3D>(report, config);
+    runTypeBenchmarks<std::string>(report, config);
+
+    runMergeCostBenchmarks<int>(report, config);
+}
+
+#endif
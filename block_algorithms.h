@@ -3,11 +3,13 @@
 #ifndef BLOCK_ALGORITHMS_H
 #define BLOCK_ALGORITHMS_H
 
+#include <utility>
+
 template <class ValueType>
 inline void swapElements(ValueType &first, ValueType &second) {
-    ValueType temp = first;
-    first = second;
-    second = temp;
+    ValueType temp = std::move(first);
+    first = std::move(second);
+    second = std::move(temp);
 }
 
 template <class RandomAccessIterator>
@@ -48,29 +50,167 @@ void reverseBlock(RandomAccessIterator begin, RandomAccessIterator end) {
     }
 }
 
-template <class RandomAccessIterator, class ValueType, class Compare>
-RandomAccessIterator upperBound(RandomAccessIterator begin, RandomAccessIterator end,
-        ValueType value, Compare comp) {
-    if (begin == end || !comp(value, *(end - 1))) {
+//moves [middle, end) in front of [begin, middle) with three reversals
+template <class RandomAccessIterator>
+void rotateBlocks(RandomAccessIterator begin, RandomAccessIterator middle, RandomAccessIterator end) {
+    if (begin == middle || middle == end) {
+        return;
+    }
+
+    reverseBlock(begin, middle);
+    reverseBlock(middle, end);
+    reverseBlock(begin, end);
+}
+
+template <class ValueType, class Compare>
+struct LessThanValue {
+    const ValueType &value;
+    Compare comp;
+
+    LessThanValue(const ValueType &value, Compare comp) : value(value), comp(comp) {}
+
+    template <class ElementType>
+    bool operator()(const ElementType &element) {
+        return comp(element, value);
+    }
+};
+
+template <class ValueType, class Compare>
+struct NotGreaterThanValue {
+    const ValueType &value;
+    Compare comp;
+
+    NotGreaterThanValue(const ValueType &value, Compare comp) : value(value), comp(comp) {}
+
+    template <class ElementType>
+    bool operator()(const ElementType &element) {
+        return !comp(value, element);
+    }
+};
+
+//finds the first element for which isBefore is false, probing 1, 3, 7, ... elements from begin
+//and then binary searching the last probed interval
+template <class RandomAccessIterator, class Predicate>
+RandomAccessIterator gallopForward(RandomAccessIterator begin, RandomAccessIterator end,
+        Predicate isBefore) {
+    size_t size = end - begin;
+    if (size == 0 || !isBefore(*begin)) {
+        return begin;
+    }
+
+    size_t lastOffset = 0;
+    size_t offset = 1;
+    while (offset < size && isBefore(*(begin + offset))) {
+        lastOffset = offset;
+        offset = 2 * offset + 1;
+        if (offset <= lastOffset) {
+            offset = size;
+        }
+    }
+    if (offset > size) {
+        offset = size;
+    }
+
+    RandomAccessIterator low = begin + lastOffset + 1;
+    RandomAccessIterator high = begin + offset;
+    while (low < high) {
+        RandomAccessIterator pointer = low + (high - low) / 2;
+        if (isBefore(*pointer)) {
+            low = pointer + 1;
+        } else {
+            high = pointer;
+        }
+    }
+
+    return low;
+}
+
+//same search probing from end towards begin
+template <class RandomAccessIterator, class Predicate>
+RandomAccessIterator gallopBackward(RandomAccessIterator begin, RandomAccessIterator end,
+        Predicate isBefore) {
+    size_t size = end - begin;
+    if (size == 0 || isBefore(*(end - 1))) {
         return end;
     }
-    return begin;
 
-    bool answerFound = false;
-    ui32 offset;
-    RandomAccessIterator pointer = begin;
-    while (!answerFound) {
-        if (comp(value, *(pointer + 1))) {
-            answerFound = true;
+    size_t lastOffset = 0;
+    size_t offset = 1;
+    while (offset < size && !isBefore(*(end - 1 - offset))) {
+        lastOffset = offset;
+        offset = 2 * offset + 1;
+        if (offset <= lastOffset) {
+            offset = size;
+        }
+    }
+    if (offset > size) {
+        offset = size;
+    }
+
+    RandomAccessIterator low = end - offset;
+    RandomAccessIterator high = end - 1 - lastOffset;
+    while (low < high) {
+        RandomAccessIterator pointer = low + (high - low) / 2;
+        if (isBefore(*pointer)) {
+            low = pointer + 1;
         } else {
-            offset = 1;
-            while (end - pointer < offset && !comp(value, *(pointer + offset))) {
-                pointer += offset;
-                offset *= 2;
-            }
+            high = pointer;
         }
     }
 
-    return pointer;
+    return low;
+}
+
+//first position whose element is not less than value
+template <class RandomAccessIterator, class ValueType, class Compare>
+RandomAccessIterator gallopLeft(RandomAccessIterator begin, RandomAccessIterator end,
+        const ValueType &value, Compare comp) {
+    return gallopForward(begin, end, LessThanValue<ValueType, Compare>(value, comp));
+}
+
+//first position whose element is greater than value
+template <class RandomAccessIterator, class ValueType, class Compare>
+RandomAccessIterator gallopRight(RandomAccessIterator begin, RandomAccessIterator end,
+        const ValueType &value, Compare comp) {
+    return gallopForward(begin, end, NotGreaterThanValue<ValueType, Compare>(value, comp));
 }
+
+template <class RandomAccessIterator, class ValueType, class Compare>
+RandomAccessIterator gallopLeftFromEnd(RandomAccessIterator begin, RandomAccessIterator end,
+        const ValueType &value, Compare comp) {
+    return gallopBackward(begin, end, LessThanValue<ValueType, Compare>(value, comp));
+}
+
+template <class RandomAccessIterator, class ValueType, class Compare>
+RandomAccessIterator gallopRightFromEnd(RandomAccessIterator begin, RandomAccessIterator end,
+        const ValueType &value, Compare comp) {
+    return gallopBackward(begin, end, NotGreaterThanValue<ValueType, Compare>(value, comp));
+}
+
+//min_gallop of CPython's timsort: galloping gets cheaper to enter while it pays off
+//and more expensive when it does not
+class GallopThreshold {
+private:
+
+    ui32 initial;
+    ui32 current;
+
+public:
+
+    explicit GallopThreshold(ui32 gallop) : initial(gallop), current(gallop) {}
+
+    ui32 get() const {
+        return current;
+    }
+
+    void update(size_t skipped) {
+        if (skipped >= initial) {
+            if (current > 1) {
+                --current;
+            }
+        } else {
+            ++current;
+        }
+    }
+};
 #endif
@@ -0,0 +1,125 @@
+#pragma once
+
+#ifndef BUFFERED_MERGE_H
+#define BUFFERED_MERGE_H
+
+template <class RandomAccessIterator, class BufferIterator, class Compare>
+void mergeLow(RandomAccessIterator begin, RandomAccessIterator middle, RandomAccessIterator end,
+        BufferIterator buffer, GallopThreshold &gallop, Compare comp) {
+    size_t bufferLength = middle - begin;
+    RandomAccessIterator rightBegin = middle;
+    BufferIterator bufferEnd = buffer;
+    for (RandomAccessIterator pointer = begin; pointer != middle; ++pointer) {
+        *(bufferEnd++) = std::move(*pointer);
+    }
+
+    ui32 bufferWins = 0;
+    ui32 runWins = 0;
+    while (buffer != bufferEnd && middle != end) {
+        if (comp(*middle, *buffer)) {
+            *(begin++) = std::move(*(middle++));
+            ++runWins;
+            bufferWins = 0;
+        } else {
+            *(begin++) = std::move(*(buffer++));
+            ++bufferWins;
+            runWins = 0;
+        }
+
+        if (buffer == bufferEnd || middle == end) {
+            break;
+        }
+
+        if (runWins >= gallop.get()) {
+            RandomAccessIterator rangeEnd = gallopLeft(middle, end, *buffer, comp);
+            gallop.update(rangeEnd - middle);
+            recordGallop(comp, rangeEnd - middle);
+            while (middle != rangeEnd) {
+                *(begin++) = std::move(*(middle++));
+            }
+            runWins = 0;
+        } else if (bufferWins >= gallop.get()) {
+            BufferIterator rangeEnd = gallopRight(buffer, bufferEnd, *middle, comp);
+            gallop.update(rangeEnd - buffer);
+            recordGallop(comp, rangeEnd - buffer);
+            while (buffer != rangeEnd) {
+                *(begin++) = std::move(*(buffer++));
+            }
+            bufferWins = 0;
+        }
+    }
+
+    while (buffer != bufferEnd) {
+        *(begin++) = std::move(*(buffer++));
+    }
+
+    //the buffered run moves twice, the tail of the right run that was never overtaken stays in place
+    recordMoves(comp, 2 * bufferLength + (middle - rightBegin));
+}
+
+template <class RandomAccessIterator, class BufferIterator, class Compare>
+void mergeHigh(RandomAccessIterator begin, RandomAccessIterator middle, RandomAccessIterator end,
+        BufferIterator buffer, GallopThreshold &gallop, Compare comp) {
+    size_t bufferLength = end - middle;
+    RandomAccessIterator leftEnd = middle;
+    BufferIterator bufferEnd = buffer;
+    for (RandomAccessIterator pointer = middle; pointer != end; ++pointer) {
+        *(bufferEnd++) = std::move(*pointer);
+    }
+
+    ui32 bufferWins = 0;
+    ui32 runWins = 0;
+    while (buffer != bufferEnd && middle != begin) {
+        if (comp(*(bufferEnd - 1), *(middle - 1))) {
+            *(--end) = std::move(*(--middle));
+            ++runWins;
+            bufferWins = 0;
+        } else {
+            *(--end) = std::move(*(--bufferEnd));
+            ++bufferWins;
+            runWins = 0;
+        }
+
+        if (buffer == bufferEnd || middle == begin) {
+            break;
+        }
+
+        if (runWins >= gallop.get()) {
+            RandomAccessIterator rangeBegin = gallopRightFromEnd(begin, middle, *(bufferEnd - 1), comp);
+            gallop.update(middle - rangeBegin);
+            recordGallop(comp, middle - rangeBegin);
+            while (middle != rangeBegin) {
+                *(--end) = std::move(*(--middle));
+            }
+            runWins = 0;
+        } else if (bufferWins >= gallop.get()) {
+            BufferIterator rangeBegin = gallopLeftFromEnd(buffer, bufferEnd, *(middle - 1), comp);
+            gallop.update(bufferEnd - rangeBegin);
+            recordGallop(comp, bufferEnd - rangeBegin);
+            while (bufferEnd != rangeBegin) {
+                *(--end) = std::move(*(--bufferEnd));
+            }
+            bufferWins = 0;
+        }
+    }
+
+    while (buffer != bufferEnd) {
+        *(--end) = std::move(*(--bufferEnd));
+    }
+
+    recordMoves(comp, 2 * bufferLength + (leftEnd - middle));
+}
+
+//copies the smaller run into the buffer and merges into place
+template <class RandomAccessIterator, class Compare>
+void bufferedMerge(RandomAccessIterator begin, RandomAccessIterator middle, RandomAccessIterator end,
+        Compare comp, MergeBuffer<RandomAccessIterator> &buffer, ui32 gallop) {
+    GallopThreshold gallopThreshold(gallop);
+
+    if (middle - begin <= end - middle) {
+        mergeLow(begin, middle, end, buffer.acquire(middle - begin), gallopThreshold, comp);
+    } else {
+        mergeHigh(begin, middle, end, buffer.acquire(end - middle), gallopThreshold, comp);
+    }
+}
+#endif
@@ -5,6 +5,8 @@
 #define DEQUE_H
 
 #include <iterator>
+#include <new>
+#include <utility>
 
 template <typename DataType>
 class Deque {
@@ -14,6 +16,11 @@ class Deque {
 
             typedef deque_iterator<ValueType, ContainerType> iterator;
 
+            public:
+
+            //the ring buffer is at most two contiguous segments, see segmented_sort.h
+            typedef ValueType* segment_pointer;
+
             private:
 
             ContainerType *container;
@@ -102,6 +109,14 @@ class Deque {
                 return &((*container)[getIndex()]);
             }
 
+            segment_pointer segment_begin() const {
+                return &((*container)[getIndex()]);
+            }
+
+            segment_pointer segment_end() const {
+                return segment_begin() + container->contiguous_size(getIndex());
+            }
+
             iterator& operator=(const iterator &other) {
                 container = other.container;
                 offset = other.offset;
@@ -165,9 +180,19 @@ private:
 
 
 
+    static DataType* allocate_vector(size_t capacity);
+
+    static size_t capacity_for(size_t size);
+
     void resize_vector(size_t new_capacity);
 
-    inline void adapt_vector(size_t new_size);
+    void relocate_vector(DataType* new_vector, size_t new_capacity);
+
+    template <class Element>
+    void emplace_back_element(Element&& new_element);
+
+    template <class Element>
+    void emplace_front_element(Element&& new_element);
 
 
 
@@ -191,14 +216,26 @@ public:
 
     void push_back(const DataType& new_element);
 
+    void push_back(DataType&& new_element);
+
     void pop_back();
 
     void push_front(const DataType& new_element);
 
+    void push_front(DataType&& new_element);
+
     void pop_front();
 
 
 
+    void reserve(size_t new_capacity);
+
+    void shrink_to_fit();
+
+    size_t capacity() const;
+
+
+
     DataType& back();
 
     const DataType& back() const;
@@ -245,6 +282,8 @@ public:
 
     const DataType& operator[](size_t index) const;
 
+    size_t contiguous_size(size_t index) const;
+
     bool operator==(const Deque<DataType> &other) const;
 
 
@@ -253,6 +292,8 @@ public:
 
     Deque(const Deque& other);
 
+    Deque& operator=(Deque other);
+
     virtual ~Deque();
 
 };
@@ -264,51 +305,51 @@ typename Deque<DataType>::template deque_iterator<ValueType, ContainerType>
     return iterator + offset;
 }
 
+//storage is left uninitialized, elements are constructed in place
+template <typename DataType>
+DataType* Deque<DataType>::allocate_vector(size_t capacity) {
+    return static_cast<DataType*>(::operator new(capacity * sizeof(DataType)));
+}
+
+//the capacity is a power of two, so indices wrap with a mask
+template <typename DataType>
+size_t Deque<DataType>::capacity_for(size_t size) {
+    size_t capacity = 4;
+    while (capacity < size) {
+        capacity *= 2;
+    }
+
+    return capacity;
+}
+
 template <typename DataType>
 void Deque<DataType>::resize_vector(size_t new_capacity) {
-    DataType* new_vector = new DataType[new_capacity];
+    relocate_vector(allocate_vector(new_capacity), new_capacity);
+}
 
+//moves the elements to the front of new_vector and frees the old storage
+template <typename DataType>
+void Deque<DataType>::relocate_vector(DataType* new_vector, size_t new_capacity) {
     for (size_t offset = 0; offset < vector_size; ++offset) {
-        new_vector[offset] = vector[move_index(begin_offset, offset)];
+        DataType& element = vector[move_index(begin_offset, offset)];
+        new (new_vector + offset) DataType(std::move(element));
+        element.~DataType();
     }
 
-    delete[] vector;
+    ::operator delete(vector);
 
     vector = new_vector;
     vector_capacity = new_capacity;
 
     begin_offset = 0;
-    end_offset = vector_size;
+    end_offset = vector_size & (vector_capacity - 1);
 
     return;
 }
 
-template <typename DataType>
-inline void Deque<DataType>::adapt_vector(size_t new_size) {
-    vector_size = new_size;
-
-    if (new_size * 4 < vector_capacity && vector_capacity / 4 >= 4) {
-        resize_vector(vector_capacity / 4);
-    } else if (new_size * 2 > vector_capacity) {
-        resize_vector(vector_capacity * 2);
-    }
-}
-
 template <typename DataType>
 inline size_t Deque<DataType>::move_index(size_t index, int offset) const {
-    bool offset_negative = offset < 0;
-
-    if (offset_negative) {
-        offset = -offset;
-    }
-
-    offset %= vector_capacity;
-
-    if (offset_negative && offset) {
-        offset = vector_capacity - offset;
-    }
-
-    return (index + offset) % vector_capacity;
+    return (index + offset) & (vector_capacity - 1);
 }
 
 template <typename DataType>
@@ -323,34 +364,98 @@ inline size_t Deque<DataType>::previous_index(size_t index) const {
 
 
 
+//the new element may refer to one of the deque's own, so a full deque builds it in the
+//grown storage before the old elements move out of the current one
 template <typename DataType>
-void Deque<DataType>::push_back(const DataType& new_element) {
-    vector[end_offset] = new_element;
+template <class Element>
+void Deque<DataType>::emplace_back_element(Element&& new_element) {
+    if (vector_size == vector_capacity) {
+        size_t new_capacity = capacity_for(vector_size + 1);
+        DataType* new_vector = allocate_vector(new_capacity);
+        new (new_vector + vector_size) DataType(std::forward<Element>(new_element));
+        relocate_vector(new_vector, new_capacity);
+    } else {
+        new (vector + end_offset) DataType(std::forward<Element>(new_element));
+    }
+
     end_offset = next_index(end_offset);
+    ++vector_size;
+}
 
-    adapt_vector(vector_size + 1);
+template <typename DataType>
+template <class Element>
+void Deque<DataType>::emplace_front_element(Element&& new_element) {
+    if (vector_size == vector_capacity) {
+        size_t new_capacity = capacity_for(vector_size + 1);
+        DataType* new_vector = allocate_vector(new_capacity);
+        new (new_vector + new_capacity - 1) DataType(std::forward<Element>(new_element));
+        relocate_vector(new_vector, new_capacity);
+    } else {
+        new (vector + previous_index(begin_offset)) DataType(std::forward<Element>(new_element));
+    }
+
+    begin_offset = previous_index(begin_offset);
+    ++vector_size;
+}
+
+template <typename DataType>
+void Deque<DataType>::push_back(const DataType& new_element) {
+    emplace_back_element(new_element);
+}
+
+template <typename DataType>
+void Deque<DataType>::push_back(DataType&& new_element) {
+    emplace_back_element(std::move(new_element));
 }
 
 template <typename DataType>
 void Deque<DataType>::pop_back() {
     end_offset = previous_index(end_offset);
+    vector[end_offset].~DataType();
 
-    adapt_vector(vector_size - 1);
+    --vector_size;
 }
 
 template <typename DataType>
 void Deque<DataType>::push_front(const DataType& new_element) {
-    begin_offset = previous_index(begin_offset);
-    vector[begin_offset] = new_element;
+    emplace_front_element(new_element);
+}
 
-    adapt_vector(vector_size + 1);
+template <typename DataType>
+void Deque<DataType>::push_front(DataType&& new_element) {
+    emplace_front_element(std::move(new_element));
 }
 
 template <typename DataType>
 void Deque<DataType>::pop_front() {
+    vector[begin_offset].~DataType();
     begin_offset = next_index(begin_offset);
 
-    adapt_vector(vector_size - 1);
+    --vector_size;
+}
+
+
+
+//the deque never shrinks by itself, so a reserved capacity survives pops
+template <typename DataType>
+void Deque<DataType>::reserve(size_t new_capacity) {
+    if (new_capacity > vector_capacity) {
+        resize_vector(capacity_for(new_capacity));
+    }
+}
+
+template <typename DataType>
+void Deque<DataType>::shrink_to_fit() {
+    size_t new_capacity = capacity_for(vector_size);
+
+    if (new_capacity < vector_capacity) {
+        resize_vector(new_capacity);
+    }
+}
+
+template <typename DataType>
+size_t Deque<DataType>::capacity() const {
+    return vector_capacity;
 }
 
 
@@ -460,11 +565,20 @@ const DataType& Deque<DataType>::operator[](size_t index) const {
     return vector[move_index(begin_offset, index)];
 }
 
+template <typename DataType>
+size_t Deque<DataType>::contiguous_size(size_t index) const {
+    size_t physical_index = move_index(begin_offset, index);
+    size_t until_wrap = vector_capacity - physical_index;
+    size_t until_end = vector_size - index;
+
+    return until_wrap < until_end ? until_wrap : until_end;
+}
+
 
 
 template <typename DataType>
 Deque<DataType>::Deque() {
-    vector = new DataType[4];
+    vector = allocate_vector(4);
 
     vector_capacity = 4;
 
@@ -475,23 +589,38 @@ Deque<DataType>::Deque() {
 
 template <typename DataType>
 Deque<DataType>::Deque(const Deque& other) {
-    vector = new DataType[other.vector_capacity];
+    vector = allocate_vector(other.vector_capacity);
 
     vector_capacity = other.vector_capacity;
 
     vector_size = other.vector_size;
 
     for (size_t offset = 0; offset < other.size(); ++offset) {
-        vector[offset] = other[offset];
+        new (vector + offset) DataType(other[offset]);
     }
 
     begin_offset = 0;
-    end_offset = vector_size;
+    end_offset = vector_size & (vector_capacity - 1);
+}
+
+template <typename DataType>
+Deque<DataType>& Deque<DataType>::operator=(Deque other) {
+    std::swap(vector, other.vector);
+    std::swap(vector_size, other.vector_size);
+    std::swap(vector_capacity, other.vector_capacity);
+    std::swap(begin_offset, other.begin_offset);
+    std::swap(end_offset, other.end_offset);
+
+    return *this;
 }
 
 template <typename DataType>
 Deque<DataType>::~Deque() {
-    delete[] vector;
+    while (!empty()) {
+        pop_back();
+    }
+
+    ::operator delete(vector);
 }
 
 #endif
@@ -0,0 +1,362 @@
+#pragma once
+
+#ifndef EXTERNAL_SORT_H
+#define EXTERNAL_SORT_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <unistd.h>
+
+#include "timsort.h"
+#include "multiway_merge.h"
+
+struct ExternalSortConfig {
+    //bytes of records kept in memory by either phase
+    size_t memoryBudget;
+    std::string tempDirectory;
+    //runs merged at once; more runs take several merge passes. It also bounds the open
+    //temporary files: at most fanIn - 1 runs wait at every level of the early merges
+    ui32 fanIn;
+
+    ExternalSortConfig() : memoryBudget(size_t(256) << 20),
+        tempDirectory(getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp"), fanIn(16) {}
+};
+
+//seconds spent in every phase
+struct ExternalSortTimings {
+    double readTime;
+    double sortTime;
+    double spillTime;
+    double mergeTime;
+    size_t runs;
+    ui32 mergePasses;
+
+    ExternalSortTimings() : readTime(0), sortTime(0), spillTime(0), mergeTime(0),
+        runs(0), mergePasses(0) {}
+};
+
+class PhaseTimer {
+private:
+
+    std::chrono::steady_clock::time_point start;
+
+public:
+
+    PhaseTimer() : start(std::chrono::steady_clock::now()) {}
+
+    double elapsed() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+};
+
+struct SpilledRun {
+    std::FILE *file;
+    size_t size;
+    //merges the records of the run have been through
+    ui32 level;
+
+    SpilledRun(std::FILE *file, size_t size, ui32 level = 0) : file(file), size(size), level(level) {}
+};
+
+//the file is unlinked right away, so it disappears with the last close even on failure
+inline std::FILE* createTempFile(const std::string &directory) {
+    std::string path = directory + "/timsort-XXXXXX";
+    std::vector<char> pathBuffer(path.begin(), path.end());
+    pathBuffer.push_back('\0');
+
+    int descriptor = mkstemp(&pathBuffer[0]);
+    if (descriptor < 0) {
+        return 0;
+    }
+    unlink(&pathBuffer[0]);
+
+    std::FILE *file = fdopen(descriptor, "w+b");
+    if (!file) {
+        close(descriptor);
+    }
+
+    return file;
+}
+
+inline void closeRuns(std::vector<SpilledRun> &runs) {
+    for (auto it = runs.begin(); it != runs.end(); ++it) {
+        std::fclose(it->file);
+    }
+    runs.clear();
+}
+
+//reads a run sequentially, one block at a time; a source for mergeSources
+template <class ValueType>
+class RunReader {
+private:
+
+    std::FILE *file;
+    size_t remaining;
+    std::vector<ValueType> block;
+    size_t position;
+    size_t blockSize;
+    bool failed;
+
+public:
+
+    RunReader(const SpilledRun &run, size_t blockSize) : file(run.file), remaining(run.size),
+        position(0), blockSize(blockSize), failed(false) {}
+
+    //false once the run is exhausted or the read failed
+    bool fill() {
+        if (position < block.size()) {
+            return true;
+        }
+
+        size_t count = remaining < blockSize ? remaining : blockSize;
+        block.resize(count);
+        position = 0;
+        if (count == 0 || std::fread(block.data(), sizeof(ValueType), count, file) != count) {
+            failed = count != 0;
+            block.clear();
+            remaining = 0;
+            return false;
+        }
+        remaining -= count;
+
+        return true;
+    }
+
+    const ValueType* begin() const {
+        return block.data() + position;
+    }
+
+    const ValueType* end() const {
+        return block.data() + block.size();
+    }
+
+    void consume(size_t count) {
+        position += count;
+    }
+
+    bool isFailed() const {
+        return failed;
+    }
+};
+
+//collects records into blocks and writes them with a single call per block
+template <class ValueType>
+class RunWriter {
+private:
+
+    std::FILE *file;
+    std::vector<ValueType> block;
+    size_t blockSize;
+    bool failed;
+
+public:
+
+    RunWriter(std::FILE *file, size_t blockSize) : file(file), blockSize(blockSize), failed(false) {
+        block.reserve(blockSize);
+    }
+
+    void write(const ValueType *begin, const ValueType *end) {
+        //the merge mostly writes single records
+        if (end - begin == 1 && block.size() + 1 < blockSize) {
+            block.push_back(*begin);
+            return;
+        }
+
+        while (begin != end) {
+            size_t count = blockSize - block.size();
+            if (count > static_cast<size_t>(end - begin)) {
+                count = end - begin;
+            }
+
+            block.insert(block.end(), begin, begin + count);
+            begin += count;
+
+            if (block.size() == blockSize) {
+                flush();
+            }
+        }
+    }
+
+    bool flush() {
+        if (!block.empty() && std::fwrite(block.data(), sizeof(ValueType), block.size(), file) != block.size()) {
+            failed = true;
+        }
+        block.clear();
+
+        return !failed && std::fflush(file) == 0;
+    }
+};
+
+//merges the runs into output through a loser tree; ties go to the earlier run, which
+//keeps the sort stable
+template <class ValueType, class Compare>
+bool mergeSpilledRuns(const std::vector<SpilledRun> &runs, std::FILE *output, Compare comp,
+        size_t blockSize) {
+    std::vector<RunReader<ValueType>> readers;
+    for (auto it = runs.begin(); it != runs.end(); ++it) {
+        std::rewind(it->file);
+        readers.push_back(RunReader<ValueType>(*it, blockSize));
+    }
+
+    RunWriter<ValueType> writer(output, blockSize);
+    mergeSources(readers, writer, comp);
+
+    for (auto it = readers.begin(); it != readers.end(); ++it) {
+        if (it->isFailed()) {
+            return false;
+        }
+    }
+
+    return writer.flush();
+}
+
+//merges the group into a new temporary run appended to mergedRuns; the files of the group
+//are closed right away, so a merge pass never holds more than fanIn + 1 of them
+template <class ValueType, class Compare>
+bool spillMergedRuns(std::vector<SpilledRun> &group, std::vector<SpilledRun> &mergedRuns, Compare comp,
+        size_t blockSize, const std::string &tempDirectory) {
+    size_t size = 0;
+    ui32 level = 0;
+    for (auto it = group.begin(); it != group.end(); ++it) {
+        size += it->size;
+        level = std::max(level, it->level);
+    }
+
+    std::FILE *file = createTempFile(tempDirectory);
+    bool success = file != 0 && mergeSpilledRuns<ValueType>(group, file, comp, blockSize);
+    closeRuns(group);
+
+    if (file) {
+        mergedRuns.push_back(SpilledRun(file, size, level + 1));
+    }
+
+    return success;
+}
+
+//sorts a binary file of trivially copyable records: chunks that fit the memory budget are
+//sorted by timSort and spilled to temporary files. As soon as fanIn runs of the same level
+//are spilled they are merged into one run of the next level, like the carries of a counter,
+//so the open files grow with the logarithm of the input; what is left is merged fanIn at
+//a time
+template <class ValueType, class Compare, class Params>
+typename std::enable_if<IsTimSortPolicy<Params>::value, bool>::type
+externalSort(const std::string &inputPath, const std::string &outputPath, Compare comp,
+        const Params &params, const ExternalSortConfig &config = ExternalSortConfig(),
+        ExternalSortTimings *timings = 0) {
+    static_assert(std::is_trivially_copyable<ValueType>::value,
+            "external sort stores records as raw bytes");
+
+    ExternalSortTimings localTimings;
+    if (!timings) {
+        timings = &localTimings;
+    }
+    *timings = ExternalSortTimings();
+
+    //the merge buffer of timSort may take as much memory as the chunk itself
+    size_t chunkSize = config.memoryBudget / (2 * sizeof(ValueType));
+    size_t blockSize = config.memoryBudget / ((config.fanIn + 1) * sizeof(ValueType));
+    if (chunkSize == 0 || blockSize == 0 || config.fanIn < 2) {
+        return false;
+    }
+
+    std::FILE *input = std::fopen(inputPath.c_str(), "rb");
+    if (!input) {
+        return false;
+    }
+
+    std::vector<SpilledRun> runs;
+    std::vector<ValueType> chunk;
+    bool success = true;
+    //the chunk stays allocated during the early merges, which get the other half of the budget
+    size_t earlyBlockSize = std::max<size_t>(blockSize / 2, 1);
+
+    while (success) {
+        PhaseTimer readTimer;
+        chunk.resize(chunkSize);
+        chunk.resize(std::fread(chunk.data(), sizeof(ValueType), chunkSize, input));
+        timings->readTime += readTimer.elapsed();
+
+        if (chunk.empty()) {
+            success = !std::ferror(input);
+            break;
+        }
+
+        PhaseTimer sortTimer;
+        timSort(chunk.begin(), chunk.end(), comp, params);
+        timings->sortTime += sortTimer.elapsed();
+
+        PhaseTimer spillTimer;
+        std::FILE *file = createTempFile(config.tempDirectory);
+        if (!file) {
+            success = false;
+        } else {
+            runs.push_back(SpilledRun(file, chunk.size()));
+            success = std::fwrite(chunk.data(), sizeof(ValueType), chunk.size(), file) == chunk.size() &&
+                std::fflush(file) == 0;
+            ++timings->runs;
+        }
+        timings->spillTime += spillTimer.elapsed();
+
+        //levels never grow towards the top of the stack, so fanIn runs of one level are adjacent
+        PhaseTimer earlyMergeTimer;
+        while (success && runs.size() >= config.fanIn &&
+                runs[runs.size() - config.fanIn].level == runs.back().level) {
+            std::vector<SpilledRun> group(runs.end() - config.fanIn, runs.end());
+            runs.erase(runs.end() - config.fanIn, runs.end());
+            success = spillMergedRuns<ValueType>(group, runs, comp, earlyBlockSize, config.tempDirectory);
+        }
+        timings->mergeTime += earlyMergeTimer.elapsed();
+    }
+
+    std::fclose(input);
+    std::vector<ValueType>().swap(chunk);
+
+    PhaseTimer mergeTimer;
+    while (success && runs.size() > config.fanIn) {
+        std::vector<SpilledRun> mergedRuns;
+        size_t first = 0;
+        for (; success && first < runs.size(); first += config.fanIn) {
+            size_t last = first + config.fanIn < runs.size() ? first + config.fanIn : runs.size();
+            std::vector<SpilledRun> group(runs.begin() + first, runs.begin() + last);
+            success = spillMergedRuns<ValueType>(group, mergedRuns, comp, blockSize, config.tempDirectory);
+        }
+
+        //after a failure the runs of the unmerged groups are still open
+        runs.erase(runs.begin(), runs.begin() + std::min(first, runs.size()));
+        mergedRuns.insert(mergedRuns.end(), runs.begin(), runs.end());
+        runs.swap(mergedRuns);
+    }
+
+    for (auto it = runs.begin(); it != runs.end(); ++it) {
+        timings->mergePasses = std::max(timings->mergePasses, it->level);
+    }
+
+    if (success) {
+        std::FILE *output = std::fopen(outputPath.c_str(), "wb");
+        success = output != 0;
+        if (success) {
+            success = mergeSpilledRuns<ValueType>(runs, output, comp, blockSize);
+            success = (std::fclose(output) == 0) && success;
+        }
+        ++timings->mergePasses;
+    }
+    timings->mergeTime += mergeTimer.elapsed();
+
+    closeRuns(runs);
+
+    return success;
+}
+
+template <class ValueType, class Compare>
+bool externalSort(const std::string &inputPath, const std::string &outputPath, Compare comp,
+        const ExternalSortConfig &config = ExternalSortConfig(), ExternalSortTimings *timings = 0) {
+    return externalSort<ValueType>(inputPath, outputPath, comp, DefaultParams(), config, timings);
+}
+
+#endif
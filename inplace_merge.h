@@ -3,23 +3,28 @@
 #ifndef INPLACE_MERGE_H
 #define INPLACE_MERGE_H
 
-template <class RandomAccessIterator, class Compare>
-void doGallop(RandomAccessIterator &begin, RandomAccessIterator end,
-        RandomAccessIterator compareWith, RandomAccessIterator &destination, Compare comp) {
+#include <algorithm>
+#include <vector>
+
+template <class RandomAccessIterator>
+size_t doGallop(RandomAccessIterator &begin, RandomAccessIterator rangeEnd,
+        RandomAccessIterator &destination) {
+    size_t skipped = rangeEnd - begin;
 
-    RandomAccessIterator rangeEnd = upperBound(begin, end, *compareWith, comp);
-    swapBlocks(destination, destination + (rangeEnd - begin), begin, rangeEnd);
-    destination += rangeEnd - begin;
+    swapBlocks(destination, destination + skipped, begin, rangeEnd);
+    destination += skipped;
     begin = rangeEnd;
 
+    return skipped;
 }
 
 template <class RandomAccessIterator, class Compare>
 void gallopMerge(RandomAccessIterator begin, RandomAccessIterator buffer, 
-        ui32 firstBlockLength, ui32 secondBlockLength, ui32 gallop, Compare comp) {
+        size_t firstBlockLength, size_t secondBlockLength, GallopThreshold &gallop, Compare comp) {
     RandomAccessIterator middle = begin + firstBlockLength;
     RandomAccessIterator end = middle + secondBlockLength;
     RandomAccessIterator bufferEnd = buffer + firstBlockLength;
+    RandomAccessIterator output = begin;
 
     swapBlocks(begin, middle, buffer, bufferEnd);
     
@@ -29,6 +34,7 @@ void gallopMerge(RandomAccessIterator begin, RandomAccessIterator buffer,
         if (middle == end) {
             swapBlocks(begin, end, buffer, bufferEnd);
             buffer = bufferEnd;
+            begin = end;
         } else if (buffer == bufferEnd) {
             middle = end;
         } else if (comp(*middle, *buffer)) {
@@ -49,29 +55,35 @@ void gallopMerge(RandomAccessIterator begin, RandomAccessIterator buffer,
             swapElements(*(begin++), *(buffer++));
         }
 
-        if (gallopCount == gallop) {
+        if (gallopCount >= gallop.get() && middle != end && buffer != bufferEnd) {
             gallopCount = 0;
 
+            size_t skipped;
             if (lastBlock == 0) {
-                doGallop(middle, end, buffer, begin, comp);
+                skipped = doGallop(middle, gallopLeft(middle, end, *buffer, comp), begin);
             } else {
-                doGallop(buffer, bufferEnd, middle, begin, comp);
+                skipped = doGallop(buffer, gallopRight(buffer, bufferEnd, *middle, comp), begin);
             }
+            gallop.update(skipped);
+            recordGallop(comp, skipped);
 
         }
     }
+
+    //one swap per element of the first block and per written position, three moves each
+    recordMoves(comp, 3 * (firstBlockLength + (begin - output)));
 }
 
 template <class RandomAccessIterator, class Compare>
 void gallopMerge(RandomAccessIterator begin, RandomAccessIterator buffer, 
-        ui32 blockLength, ui32 gallop, Compare comp) {
+        size_t blockLength, GallopThreshold &gallop, Compare comp) {
     gallopMerge(begin, buffer, blockLength, blockLength, gallop, comp);
 }
 
 template <class RandomAccessIterator>
-ui32 findBlockLength(RandomAccessIterator begin, RandomAccessIterator end) {
-    ui32 blockLength = 1;
-    while ((blockLength + 1) * (blockLength + 1) <= end - begin) {
+size_t findBlockLength(RandomAccessIterator begin, RandomAccessIterator end) {
+    size_t blockLength = 1;
+    while ((blockLength + 1) * (blockLength + 1) <= static_cast<size_t>(end - begin)) {
         ++blockLength;
     }
 
@@ -80,9 +92,9 @@ ui32 findBlockLength(RandomAccessIterator begin, RandomAccessIterator end) {
 
 template <class RandomAccessIterator>
 RandomAccessIterator prepareBufferBlock(RandomAccessIterator begin, RandomAccessIterator middle,
-        RandomAccessIterator end, ui32 blockLength, ui32 remainingSize) {
+        RandomAccessIterator end, size_t blockLength, size_t remainingSize) {
     RandomAccessIterator bufferBlock = end;
-    for (RandomAccessIterator pointer = begin; end - pointer >= blockLength; pointer += blockLength) {
+    for (RandomAccessIterator pointer = begin; static_cast<size_t>(end - pointer) >= blockLength; pointer += blockLength) {
         if (pointer <= middle && middle < pointer + blockLength) {
             bufferBlock = pointer;
         }
@@ -96,28 +108,63 @@ RandomAccessIterator prepareBufferBlock(RandomAccessIterator begin, RandomAccess
     return end - remainingSize;
 }
 
+//orders block numbers by their blocks; equal blocks keep their order, so the ordering is strict
 template <class RandomAccessIterator, class Compare>
-void sortBlocks(RandomAccessIterator begin, RandomAccessIterator end, Compare comp, ui32 blockLength) {
-    RandomAccessIterator minBlock;
-    for (RandomAccessIterator insertPosition = begin; insertPosition != end; 
-            insertPosition += blockLength) {
-        minBlock = insertPosition;
-
-        for (RandomAccessIterator currentBlock = insertPosition + blockLength;
-                currentBlock != end; currentBlock += blockLength) {
-            if (compareBlocks(currentBlock, currentBlock + blockLength, 
-                        minBlock, minBlock + blockLength, comp)) {
-                minBlock = currentBlock;
-            }
+struct BlockIndexCompare {
+    RandomAccessIterator begin;
+    size_t blockLength;
+    Compare comp;
+
+    BlockIndexCompare(RandomAccessIterator begin, size_t blockLength, Compare comp)
+        : begin(begin), blockLength(blockLength), comp(comp) {}
+
+    bool operator()(ui32 first, ui32 second) {
+        RandomAccessIterator firstBlock = begin + first * blockLength;
+        RandomAccessIterator secondBlock = begin + second * blockLength;
+
+        if (compareBlocks(firstBlock, firstBlock + blockLength, secondBlock, secondBlock + blockLength, comp)) {
+            return true;
+        } else if (compareBlocks(secondBlock, secondBlock + blockLength, firstBlock, firstBlock + blockLength, comp)) {
+            return false;
         }
 
-        swapBlocks(minBlock, minBlock + blockLength, insertPosition, insertPosition + blockLength);
+        return first < second;
+    }
+};
+
+//the order of the blocks is found on their numbers with O(k log k) comparisons and then
+//applied cycle by cycle, so every block is swapped into its place exactly once
+template <class RandomAccessIterator, class Compare>
+void sortBlocks(RandomAccessIterator begin, RandomAccessIterator end, Compare comp, size_t blockLength) {
+    ui32 blocksCount = (end - begin) / blockLength;
+
+    std::vector<ui32> order(blocksCount);
+    for (ui32 index = 0; index < blocksCount; ++index) {
+        order[index] = index;
+    }
+    std::sort(order.begin(), order.end(),
+            BlockIndexCompare<RandomAccessIterator, Compare>(begin, blockLength, comp));
+
+    //order[position] is the block that belongs at position; a finished position points to itself
+    for (ui32 cycleStart = 0; cycleStart < blocksCount; ++cycleStart) {
+        ui32 position = cycleStart;
+        while (order[position] != cycleStart && order[position] != position) {
+            ui32 source = order[position];
+            order[position] = position;
+
+            RandomAccessIterator positionBlock = begin + position * blockLength;
+            RandomAccessIterator sourceBlock = begin + source * blockLength;
+            swapBlocks(positionBlock, positionBlock + blockLength, sourceBlock, sourceBlock + blockLength);
+
+            position = source;
+        }
+        order[position] = position;
     }
 }
 
 template <class RandomAccessIterator, class Compare>
 void mergeBlocks(RandomAccessIterator begin, RandomAccessIterator end, Compare comp,
-        ui32 blockLength, ui32 gallop) {
+        size_t blockLength, GallopThreshold &gallop) {
     for (RandomAccessIterator currentBlock = begin + blockLength; currentBlock != end;
             currentBlock += blockLength) {
         gallopMerge(currentBlock - blockLength, end, blockLength, gallop, comp);
@@ -126,8 +173,8 @@ void mergeBlocks(RandomAccessIterator begin, RandomAccessIterator end, Compare c
 
 template <class RandomAccessIterator, class Compare>
 void reverseMergeBlocks(RandomAccessIterator begin, RandomAccessIterator end, 
-        RandomAccessIterator bufferBlock, Compare comp, ui32 blockLength, ui32 gallop) {
-    if (end - begin >= 3 * blockLength) {
+        RandomAccessIterator bufferBlock, Compare comp, size_t blockLength, GallopThreshold &gallop) {
+    if (static_cast<size_t>(end - begin) >= 3 * blockLength) {
         for (RandomAccessIterator currentBlock = end - 3 * blockLength; currentBlock >= begin;
                 currentBlock -= blockLength) {
             gallopMerge(currentBlock, bufferBlock, blockLength, gallop, comp);
@@ -139,27 +186,98 @@ void reverseMergeBlocks(RandomAccessIterator begin, RandomAccessIterator end,
     insertionSort(bufferBlock, bufferBlock + blockLength, comp);
 }
 
+//one step of SymMerge: a binary search finds the longest symmetric pair of blocks around
+//the middle of [begin, end) that have to change places and a rotation swaps them. What is
+//left are two independent merges, [begin, leftMiddle, center) and [center, rightMiddle, end)
+template <class RandomAccessIterator, class Compare>
+RandomAccessIterator symMergeRotate(RandomAccessIterator begin, RandomAccessIterator middle,
+        RandomAccessIterator end, Compare comp, RandomAccessIterator &leftMiddle,
+        RandomAccessIterator &rightMiddle) {
+    size_t half = (end - begin) / 2;
+    RandomAccessIterator center = begin + half;
+    //the element at begin + i is paired with the one at mirror - i
+    size_t leftLength = middle - begin;
+    size_t low = (leftLength > half) ? leftLength - (end - center) : 0;
+    size_t high = (leftLength > half) ? half : leftLength;
+    RandomAccessIterator mirror = center + (middle - begin) - 1;
+
+    while (low < high) {
+        size_t probe = low + (high - low) / 2;
+        if (!comp(*(mirror - probe), *(begin + probe))) {
+            low = probe + 1;
+        } else {
+            high = probe;
+        }
+    }
+
+    leftMiddle = begin + low;
+    rightMiddle = mirror + 1 - low;
+    rotateBlocks(leftMiddle, middle, rightMiddle);
+    recordMoves(comp, 3 * (rightMiddle - leftMiddle));
+
+    return center;
+}
+
+//SymMerge of Kim and Kutzner, rotations all the way down. It is stable and costs
+//O(m log(n / m + 1)) comparisons for runs of m <= n elements, which makes it cheap
+//when one run is short
+template <class RandomAccessIterator, class Compare>
+void symMerge(RandomAccessIterator begin, RandomAccessIterator middle, RandomAccessIterator end,
+        Compare comp) {
+    if (middle - begin == 1) {
+        RandomAccessIterator position = gallopLeft(middle, end, *begin, comp);
+        rotateBlocks(begin, middle, position);
+        recordMoves(comp, 3 * (position - begin));
+        return;
+    }
+
+    if (end - middle == 1) {
+        RandomAccessIterator position = gallopRightFromEnd(begin, middle, *middle, comp);
+        rotateBlocks(position, middle, end);
+        recordMoves(comp, 3 * (end - position));
+        return;
+    }
+
+    RandomAccessIterator leftMiddle, rightMiddle;
+    RandomAccessIterator center = symMergeRotate(begin, middle, end, comp, leftMiddle, rightMiddle);
+
+    if (begin < leftMiddle && leftMiddle < center) {
+        symMerge(begin, leftMiddle, center, comp);
+    }
+    if (center < rightMiddle && rightMiddle < end) {
+        symMerge(center, rightMiddle, end, comp);
+    }
+}
+
 template <class RandomAccessIterator, class Compare>
 void inplaceMerge(RandomAccessIterator begin, RandomAccessIterator middle, RandomAccessIterator end,
         Compare comp, ui32 gallop) {
-    ui32 blockLength = findBlockLength(begin, end);
-    ui32 remainingSize = blockLength + (end - begin) % blockLength;
+    //rotations beat the block machinery unless both runs are long
+    size_t shortLength = std::min(middle - begin, end - middle);
+    if (end - begin <= (1 << 16) || 8 * shortLength <= static_cast<size_t>(end - begin)) {
+        symMerge(begin, middle, end, comp);
+        return;
+    }
+
+    size_t blockLength = findBlockLength(begin, end);
+    size_t remainingSize = blockLength + (end - begin) % blockLength;
 
     RandomAccessIterator bufferBlock = prepareBufferBlock(begin, middle, end, blockLength, remainingSize);
+    GallopThreshold gallopThreshold(gallop);
 
     sortBlocks(begin, bufferBlock, comp, blockLength);
 
-    mergeBlocks(begin, bufferBlock, comp, blockLength, gallop);
+    mergeBlocks(begin, bufferBlock, comp, blockLength, gallopThreshold);
 
     //sorting buffer
 
-    if (end - begin <= 2 * remainingSize) {
+    if (static_cast<size_t>(end - begin) <= 2 * remainingSize) {
         insertionSort(begin, end, comp);
         return;
     }
 
     insertionSort(end - 2 * remainingSize, end, comp);
 
-    reverseMergeBlocks(begin, end, bufferBlock, comp, remainingSize, gallop);
+    reverseMergeBlocks(begin, end, bufferBlock, comp, remainingSize, gallopThreshold);
 }
 #endif
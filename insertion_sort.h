@@ -16,4 +16,42 @@ void insertionSort(RandomAccessIterator begin, RandomAccessIterator end, Compare
         }
     }
 }
+
+//[begin, sortedEnd) must already be sorted; every following element is found its place
+//by binary search and moved once, shifting the tail of the sorted part through a single hole
+template <class RandomAccessIterator, class Compare>
+void binaryInsertionSort(RandomAccessIterator begin, RandomAccessIterator sortedEnd,
+        RandomAccessIterator end, Compare comp) {
+    typedef typename std::iterator_traits<RandomAccessIterator>::value_type ValueType;
+
+    if (begin == sortedEnd) {
+        if (begin == end)
+            return;
+        ++sortedEnd;
+    }
+
+    for (; sortedEnd != end; ++sortedEnd) {
+        ValueType value = std::move(*sortedEnd);
+
+        RandomAccessIterator low = begin;
+        RandomAccessIterator high = sortedEnd;
+        while (low < high) {
+            RandomAccessIterator pointer = low + (high - low) / 2;
+            if (comp(value, *pointer)) {
+                high = pointer;
+            } else {
+                low = pointer + 1;
+            }
+        }
+
+        RandomAccessIterator hole = sortedEnd;
+        while (hole != low) {
+            *hole = std::move(*(hole - 1));
+            --hole;
+        }
+        *hole = std::move(value);
+
+        recordMoves(comp, sortedEnd - low + 2);
+    }
+}
 #endif
@@ -23,7 +23,7 @@ int main() {
     for (int i = 0; i < 10000; ++i) {
         std::cout << d[i] << ' ';
         if (i) {
-            assert(d[i] >= d[i-1]);
+            assert(d[i] <= d[i-1]);
         }
     }
 
@@ -0,0 +1,47 @@
+#pragma once
+
+#ifndef MERGE_H
+#define MERGE_H
+
+//shrinks [begin, end) to the part that actually has to move: elements of the left run
+//not greater than the head of the right run and elements of the right run not less
+//than the tail of the left run are already in place
+template <class RandomAccessIterator, class Compare>
+bool trimMergeRange(RandomAccessIterator &begin, RandomAccessIterator middle,
+        RandomAccessIterator &end, Compare comp) {
+    if (begin == middle || middle == end) {
+        return false;
+    }
+
+    begin = gallopRight(begin, middle, *middle, comp);
+    if (begin == middle) {
+        return false;
+    }
+
+    end = gallopLeftFromEnd(middle, end, *(middle - 1), comp);
+
+    return true;
+}
+
+template <class RandomAccessIterator, class Compare, class Params>
+void mergeRanges(RandomAccessIterator begin, RandomAccessIterator middle, RandomAccessIterator end,
+        Compare comp, const Params &params, MergeBuffer<RandomAccessIterator> &buffer) {
+    if (!trimMergeRange(begin, middle, end, comp)) {
+        return;
+    }
+
+    recordMergeMode(comp, params.GetMergeMode());
+
+    switch (params.GetMergeMode()) {
+        case MM_Inplace:
+            inplaceMerge(begin, middle, end, comp, params.GetGallop());
+            break;
+        case MM_Buffered:
+            bufferedMerge(begin, middle, end, comp, buffer, params.GetGallop());
+            break;
+        case MM_StableInplace:
+            stableInplaceMerge(begin, middle, end, comp, params.GetGallop());
+            break;
+    }
+}
+#endif
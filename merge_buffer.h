@@ -0,0 +1,33 @@
+#pragma once
+
+#ifndef MERGE_BUFFER_H
+#define MERGE_BUFFER_H
+
+#include <vector>
+
+template <class RandomAccessIterator>
+class MergeBuffer {
+typedef typename std::iterator_traits<RandomAccessIterator>::value_type ValueType;
+private:
+
+    std::vector<ValueType> storage;
+
+public:
+
+    typedef typename std::vector<ValueType>::iterator iterator;
+
+    iterator acquire(size_t size) {
+        if (storage.size() < size) {
+            size_t newSize = 2 * storage.size();
+            if (newSize < size) {
+                newSize = size;
+            }
+
+            std::vector<ValueType>(newSize).swap(storage);
+        }
+
+        return storage.begin();
+    }
+
+};
+#endif
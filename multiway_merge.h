@@ -0,0 +1,226 @@
+#pragma once
+
+#ifndef MULTIWAY_MERGE_H
+#define MULTIWAY_MERGE_H
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "timsort.h"
+
+//a sorted input handed out block by block: begin() and end() give the current block,
+//consume(count) drops its first count elements, fill() loads the next block once the
+//current one is used up and returns false when the input is exhausted
+template <class RandomAccessIterator>
+class RangeSource {
+private:
+
+    RandomAccessIterator first;
+    RandomAccessIterator last;
+
+public:
+
+    RangeSource(RandomAccessIterator first, RandomAccessIterator last) : first(first), last(last) {}
+
+    bool fill() const {
+        return first != last;
+    }
+
+    RandomAccessIterator begin() const {
+        return first;
+    }
+
+    RandomAccessIterator end() const {
+        return last;
+    }
+
+    void consume(size_t count) {
+        first += count;
+    }
+};
+
+template <class OutputIterator>
+class OutputWriter {
+private:
+
+    OutputIterator output;
+
+public:
+
+    explicit OutputWriter(OutputIterator output) : output(output) {}
+
+    template <class InputIterator>
+    void write(InputIterator begin, InputIterator end) {
+        output = std::copy(begin, end, output);
+    }
+
+    OutputIterator get() const {
+        return output;
+    }
+};
+
+//tournament over the heads of the sources: every inner node keeps the loser of its match,
+//so a new head of the winner is replayed along a single leaf-to-root path with log k
+//comparisons. Ties go to the source with the smaller index
+template <class Source, class Compare>
+class LoserTree {
+private:
+
+    std::vector<Source> &sources;
+    //losers[0] is the overall winner
+    std::vector<ui32> losers;
+    std::vector<char> alive;
+    ui32 leaves;
+    Compare comp;
+
+    bool beats(ui32 first, ui32 second) {
+        if (!alive[first]) {
+            return false;
+        }
+        if (!alive[second]) {
+            return true;
+        }
+
+        if (first < second) {
+            return !comp(*sources[second].begin(), *sources[first].begin());
+        }
+        return comp(*sources[first].begin(), *sources[second].begin());
+    }
+
+public:
+
+    LoserTree(std::vector<Source> &sources, Compare comp) : sources(sources), leaves(1), comp(comp) {
+        while (leaves < sources.size()) {
+            leaves *= 2;
+        }
+
+        alive.resize(leaves);
+        for (ui32 index = 0; index < leaves; ++index) {
+            alive[index] = index < sources.size() && sources[index].fill();
+        }
+
+        //winners of the subtrees, leaves are stored at leaves + source
+        std::vector<ui32> winners(2 * leaves);
+        for (ui32 index = 0; index < leaves; ++index) {
+            winners[leaves + index] = index;
+        }
+
+        losers.resize(leaves);
+        for (ui32 node = leaves - 1; node > 0; --node) {
+            ui32 left = winners[2 * node];
+            ui32 right = winners[2 * node + 1];
+
+            if (beats(right, left)) {
+                std::swap(left, right);
+            }
+            winners[node] = left;
+            losers[node] = right;
+        }
+        losers[0] = winners[1];
+    }
+
+    bool isEmpty() const {
+        return !alive[losers[0]];
+    }
+
+    ui32 getWinner() const {
+        return losers[0];
+    }
+
+    //the best head apart from the winner; it lost its last match to the winner, so it is
+    //one of the losers on the winner's path
+    bool getRunnerUp(ui32 &runnerUp) {
+        bool found = false;
+        for (ui32 node = (losers[0] + leaves) / 2; node > 0; node /= 2) {
+            ui32 candidate = losers[node];
+            if (alive[candidate] && (!found || beats(candidate, runnerUp))) {
+                runnerUp = candidate;
+                found = true;
+            }
+        }
+
+        return found;
+    }
+
+    //call after the head of the source has been consumed
+    void replay(ui32 source) {
+        alive[source] = sources[source].fill();
+
+        ui32 winner = source;
+        for (ui32 node = (source + leaves) / 2; node > 0; node /= 2) {
+            if (beats(losers[node], winner)) {
+                std::swap(losers[node], winner);
+            }
+        }
+        losers[0] = winner;
+    }
+};
+
+//merges sorted sources into writer.write(begin, end) with a loser tree; the merge is
+//stable with respect to the order of the sources. Once a source keeps winning, its block
+//is galloped against the runner-up and written as one stretch
+template <class Source, class Writer, class Compare>
+void mergeSources(std::vector<Source> &sources, Writer &writer, Compare comp) {
+    LoserTree<Source, Compare> tree(sources, comp);
+    GallopThreshold gallop(DefaultParams::GetGallop());
+
+    ui32 lastWinner = 0;
+    ui32 wins = 0;
+    while (!tree.isEmpty()) {
+        ui32 winner = tree.getWinner();
+        Source &source = sources[winner];
+
+        if (winner != lastWinner) {
+            lastWinner = winner;
+            wins = 0;
+        }
+        ++wins;
+
+        auto stretchEnd = source.begin() + 1;
+        if (wins >= gallop.get()) {
+            ui32 runnerUp = 0;
+            if (!tree.getRunnerUp(runnerUp)) {
+                stretchEnd = source.end();
+            } else if (winner < runnerUp) {
+                stretchEnd = gallopRight(source.begin(), source.end(), *sources[runnerUp].begin(), comp);
+            } else {
+                stretchEnd = gallopLeft(source.begin(), source.end(), *sources[runnerUp].begin(), comp);
+            }
+
+            gallop.update(stretchEnd - source.begin());
+            recordGallop(comp, stretchEnd - source.begin());
+            wins = 0;
+        }
+
+        writer.write(source.begin(), stretchEnd);
+        source.consume(stretchEnd - source.begin());
+        tree.replay(winner);
+    }
+}
+
+//merges already sorted ranges into output without rediscovering their runs; each element
+//costs about log k comparisons for k ranges, ties keep the order of the ranges
+template <class RandomAccessIterator, class OutputIterator, class Compare>
+OutputIterator multiwayMerge(const std::vector<std::pair<RandomAccessIterator, RandomAccessIterator>> &ranges,
+        OutputIterator output, Compare comp) {
+    std::vector<RangeSource<RandomAccessIterator>> sources;
+    for (auto it = ranges.begin(); it != ranges.end(); ++it) {
+        sources.push_back(RangeSource<RandomAccessIterator>(it->first, it->second));
+    }
+
+    OutputWriter<OutputIterator> writer(output);
+    mergeSources(sources, writer, comp);
+
+    return writer.get();
+}
+
+template <class RandomAccessIterator, class OutputIterator>
+OutputIterator multiwayMerge(const std::vector<std::pair<RandomAccessIterator, RandomAccessIterator>> &ranges,
+        OutputIterator output) {
+    typedef typename std::iterator_traits<RandomAccessIterator>::value_type ValueType;
+    return multiwayMerge(ranges, output, LessCompare<ValueType>());
+}
+
+#endif
@@ -0,0 +1,104 @@
+#pragma once
+
+#ifndef PARALLEL_MERGE_H
+#define PARALLEL_MERGE_H
+
+#include <thread>
+#include <vector>
+
+//merge path co-ranking: the number of elements the left run [begin, middle) contributes
+//to the first diagonal elements of the merge; ties go to the left run, so merging
+//the two sides of the split independently is stable
+template <class RandomAccessIterator, class Compare>
+size_t coRank(RandomAccessIterator begin, RandomAccessIterator middle, RandomAccessIterator end,
+        size_t diagonal, Compare comp) {
+    size_t leftSize = middle - begin;
+    size_t rightSize = end - middle;
+
+    size_t low = (diagonal > rightSize ? diagonal - rightSize : 0);
+    size_t high = (diagonal < leftSize ? diagonal : leftSize);
+    while (low < high) {
+        size_t taken = low + (high - low) / 2;
+        if (!comp(*(middle + (diagonal - taken - 1)), *(begin + taken))) {
+            low = taken + 1;
+        } else {
+            high = taken;
+        }
+    }
+
+    return low;
+}
+
+template <class RandomAccessIterator>
+void reverseSlice(RandomAccessIterator begin, RandomAccessIterator end, size_t sliceBegin, size_t sliceEnd) {
+    for (size_t offset = sliceBegin; offset < sliceEnd; ++offset) {
+        swapElements(*(begin + offset), *(end - 1 - offset));
+    }
+}
+
+template <class RandomAccessIterator>
+void parallelReverse(RandomAccessIterator begin, RandomAccessIterator end, ui32 threads) {
+    size_t half = (end - begin) / 2;
+    if (threads > half / 4096 + 1) {
+        threads = half / 4096 + 1;
+    }
+
+    std::vector<std::thread> workers;
+    for (ui32 slice = 1; slice < threads; ++slice) {
+        workers.push_back(std::thread(reverseSlice<RandomAccessIterator>, begin, end,
+                    half * slice / threads, half * (slice + 1) / threads));
+    }
+    reverseSlice(begin, end, 0, half / threads);
+
+    for (auto it = workers.begin(); it != workers.end(); ++it) {
+        it->join();
+    }
+}
+
+template <class RandomAccessIterator>
+void parallelRotate(RandomAccessIterator begin, RandomAccessIterator middle, RandomAccessIterator end,
+        ui32 threads) {
+    parallelReverse(begin, middle, threads);
+    parallelReverse(middle, end, threads);
+    parallelReverse(begin, end, threads);
+}
+
+//splits the merge at the merge path diagonal proportional to the thread budget,
+//rotates the inner parts so the two sub-merges become adjacent pairs of runs
+//and merges both halves concurrently, recursing until every thread has its own
+//sub-merge of (almost) equal size
+template <class RandomAccessIterator, class Compare, class Params>
+void splitMerge(RandomAccessIterator begin, RandomAccessIterator middle, RandomAccessIterator end,
+        Compare comp, const Params *params, ui32 threads) {
+    if (!trimMergeRange(begin, middle, end, comp)) {
+        return;
+    }
+
+    if (threads <= 1 || static_cast<size_t>(end - begin) < params->GetParallelMergeThreshold()) {
+        MergeBuffer<RandomAccessIterator> buffer;
+        mergeRanges(begin, middle, end, comp, *params, buffer);
+        return;
+    }
+
+    ui32 leftThreads = threads / 2;
+    size_t diagonal = (end - begin) / threads * leftThreads + (end - begin) % threads * leftThreads / threads;
+
+    size_t leftTaken = coRank(begin, middle, end, diagonal, comp);
+    RandomAccessIterator leftSplit = begin + leftTaken;
+    RandomAccessIterator rightSplit = middle + (diagonal - leftTaken);
+    RandomAccessIterator split = begin + diagonal;
+
+    parallelRotate(leftSplit, middle, rightSplit, threads);
+
+    std::thread rightWorker(splitMerge<RandomAccessIterator, Compare, Params>,
+            split, split + (middle - leftSplit), end, comp, params, threads - leftThreads);
+    splitMerge(begin, leftSplit, split, comp, params, leftThreads);
+    rightWorker.join();
+}
+
+template <class RandomAccessIterator, class Compare, class Params>
+void parallelMerge(RandomAccessIterator begin, RandomAccessIterator middle, RandomAccessIterator end,
+        Compare comp, const Params &params, ui32 threads) {
+    splitMerge(begin, middle, end, comp, &params, threads);
+}
+#endif
@@ -0,0 +1,97 @@
+#pragma once
+
+#ifndef PARALLEL_TIMSORT_H
+#define PARALLEL_TIMSORT_H
+
+#include <thread>
+#include <vector>
+
+#include "timsort.h"
+
+template <class RandomAccessIterator, class Compare, class Params>
+void sortChunk(RunInfo<RandomAccessIterator> chunk, Compare comp, const Params *params) {
+    timSort(chunk.begin, chunk.begin + chunk.size, comp, *params);
+}
+
+template <class RandomAccessIterator, class Compare, class Params>
+void mergeChunks(RunInfo<RandomAccessIterator> chunkY, RunInfo<RandomAccessIterator> chunkX,
+        Compare comp, const Params *params, ui32 threads) {
+    splitMerge(chunkY.begin, chunkX.begin, chunkX.begin + chunkX.size, comp, params, threads);
+}
+
+//every thread sorts its own chunk with the sequential timsort, then neighbouring chunks
+//are merged pairwise until a single run is left; the threads of a level are shared
+//among its merges, which are split further along the merge path;
+//presorted chunks merge in O(log n) thanks to the galloping in trimMergeRange
+template <class RandomAccessIterator, class Compare, class Params>
+void parallelTimSort(RandomAccessIterator begin, RandomAccessIterator end, Compare comp,
+        ui32 threads, const Params &params) {
+    const ui32 minChunkSize = 1 << 13;
+
+    size_t count = end - begin;
+    if (threads > count / minChunkSize) {
+        threads = count / minChunkSize;
+    }
+
+    if (threads <= 1) {
+        timSort(begin, end, comp, params);
+        return;
+    }
+
+    std::vector<RunInfo<RandomAccessIterator>> chunks;
+    for (ui32 chunk = 0; chunk < threads; ++chunk) {
+        size_t chunkBegin = count / threads * chunk + count % threads * chunk / threads;
+        size_t chunkEnd = count / threads * (chunk + 1) + count % threads * (chunk + 1) / threads;
+        chunks.push_back(RunInfo<RandomAccessIterator>(begin + chunkBegin, chunkEnd - chunkBegin));
+    }
+
+    std::vector<std::thread> workers;
+    for (auto it = chunks.begin(); it != chunks.end(); ++it) {
+        workers.push_back(std::thread(sortChunk<RandomAccessIterator, Compare, Params>, *it, comp, &params));
+    }
+    for (auto it = workers.begin(); it != workers.end(); ++it) {
+        it->join();
+    }
+
+    while (chunks.size() > 1) {
+        std::vector<RunInfo<RandomAccessIterator>> mergedChunks;
+        workers.clear();
+
+        ui32 mergeThreads = threads / (chunks.size() / 2);
+        for (ui32 chunk = 0; chunk + 1 < chunks.size(); chunk += 2) {
+            workers.push_back(std::thread(mergeChunks<RandomAccessIterator, Compare, Params>,
+                        chunks[chunk], chunks[chunk + 1], comp, &params, mergeThreads));
+            mergedChunks.push_back(RunInfo<RandomAccessIterator>(chunks[chunk].begin,
+                        chunks[chunk].size + chunks[chunk + 1].size));
+        }
+        if (chunks.size() % 2) {
+            mergedChunks.push_back(chunks.back());
+        }
+
+        for (auto it = workers.begin(); it != workers.end(); ++it) {
+            it->join();
+        }
+
+        chunks.swap(mergedChunks);
+    }
+}
+
+template <class RandomAccessIterator, class Compare>
+void parallelTimSort(RandomAccessIterator begin, RandomAccessIterator end, Compare comp, ui32 threads) {
+    parallelTimSort(begin, end, comp, threads, DefaultParams());
+}
+
+template <class RandomAccessIterator, class Params>
+typename std::enable_if<IsTimSortPolicy<Params>::value>::type
+parallelTimSort(RandomAccessIterator begin, RandomAccessIterator end, ui32 threads, const Params &params) {
+    parallelTimSort(begin, end,
+            LessCompare<typename std::iterator_traits<RandomAccessIterator>::value_type>(), threads, params);
+}
+
+template <class RandomAccessIterator>
+void parallelTimSort(RandomAccessIterator begin, RandomAccessIterator end, ui32 threads) {
+    parallelTimSort(begin, end,
+            LessCompare<typename std::iterator_traits<RandomAccessIterator>::value_type>(), threads);
+}
+
+#endif
@@ -0,0 +1,200 @@
+#pragma once
+
+#ifndef RADIX_SORT_H
+#define RADIX_SORT_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+template <size_t size>
+struct UnsignedOfSize;
+
+template <>
+struct UnsignedOfSize<1> {
+    typedef uint8_t type;
+};
+
+template <>
+struct UnsignedOfSize<2> {
+    typedef uint16_t type;
+};
+
+template <>
+struct UnsignedOfSize<4> {
+    typedef uint32_t type;
+};
+
+template <>
+struct UnsignedOfSize<8> {
+    typedef uint64_t type;
+};
+
+//maps a value to an unsigned key with the same order: the sign bit of integers is flipped,
+//negative floats have all bits inverted, and -0.0 becomes 0.0 so that both stay equal
+template <class ValueType, class Enable = void>
+struct RadixKey {
+    static const bool available = false;
+};
+
+template <class ValueType>
+struct RadixKey<ValueType, typename std::enable_if<std::is_integral<ValueType>::value &&
+        !std::is_same<ValueType, bool>::value>::type> {
+    static const bool available = true;
+    typedef typename UnsignedOfSize<sizeof(ValueType)>::type Key;
+
+    static Key get(ValueType value) {
+        const Key signBit = std::is_signed<ValueType>::value ? Key(1) << (8 * sizeof(Key) - 1) : 0;
+        return static_cast<Key>(value) ^ signBit;
+    }
+};
+
+template <class ValueType>
+struct RadixKey<ValueType, typename std::enable_if<std::is_floating_point<ValueType>::value &&
+        (sizeof(ValueType) == 4 || sizeof(ValueType) == 8)>::type> {
+    static const bool available = true;
+    typedef typename UnsignedOfSize<sizeof(ValueType)>::type Key;
+
+    static Key get(ValueType value) {
+        const Key signBit = Key(1) << (8 * sizeof(Key) - 1);
+
+        if (value == 0) {
+            value = 0;
+        }
+
+        Key bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return (bits & signBit) ? ~bits : (bits | signBit);
+    }
+};
+
+//stable LSD radix sort by bytes; passes where every key has the same byte are skipped.
+//Returns the number of element moves
+template <class ValueType, bool isGreater>
+size_t radixSort(ValueType *begin, ValueType *end, ValueType *buffer) {
+    typedef RadixKey<ValueType> Radix;
+    typedef typename Radix::Key Key;
+    const ui32 digits = sizeof(Key);
+
+    size_t size = end - begin;
+    size_t moves = 0;
+    size_t counts[digits][256];
+    memset(counts, 0, sizeof(counts));
+
+    for (ValueType *pointer = begin; pointer != end; ++pointer) {
+        Key key = (isGreater ? ~Radix::get(*pointer) : Radix::get(*pointer));
+        for (ui32 digit = 0; digit < digits; ++digit) {
+            ++counts[digit][(key >> (8 * digit)) & 255];
+        }
+    }
+
+    ValueType *source = begin;
+    ValueType *target = buffer;
+    for (ui32 digit = 0; digit < digits; ++digit) {
+        Key firstKey = (isGreater ? ~Radix::get(*source) : Radix::get(*source));
+        if (counts[digit][(firstKey >> (8 * digit)) & 255] == size) {
+            continue;
+        }
+
+        size_t offset = 0;
+        for (ui32 bucket = 0; bucket < 256; ++bucket) {
+            size_t count = counts[digit][bucket];
+            counts[digit][bucket] = offset;
+            offset += count;
+        }
+
+        for (ValueType *pointer = source; pointer != source + size; ++pointer) {
+            Key key = (isGreater ? ~Radix::get(*pointer) : Radix::get(*pointer));
+            target[counts[digit][(key >> (8 * digit)) & 255]++] = *pointer;
+        }
+
+        std::swap(source, target);
+        moves += size;
+    }
+
+    if (source != begin) {
+        std::copy(source, source + size, begin);
+        moves += size;
+    }
+
+    return moves;
+}
+
+template <class RandomAccessIterator, class Compare>
+struct CanRadixSort {
+    typedef typename std::iterator_traits<RandomAccessIterator>::value_type ValueType;
+
+    static const bool value = IsContiguousIterator<RandomAccessIterator>::value &&
+        RadixKey<ValueType>::available && SimdOrder<Compare, ValueType>::available;
+};
+
+//estimates the number of natural runs from the run breaks inside a few windows spread
+//over the range; the lower quartile of the windows is used, so that a random region
+//in an otherwise presorted input does not count
+template <class RandomAccessIterator, class Compare>
+size_t estimateRuns(RandomAccessIterator begin, RandomAccessIterator end, Compare comp) {
+    const ui32 windows = 8;
+    size_t size = end - begin;
+    size_t windowLength = std::min<size_t>(std::max<size_t>(size / 128, 256), size);
+    size_t step = (size - windowLength) / (windows - 1);
+
+    size_t breaks[windows];
+    for (ui32 window = 0; window < windows; ++window) {
+        RandomAccessIterator windowEnd = begin + window * step + windowLength;
+        RandomAccessIterator runBegin = begin + window * step;
+
+        breaks[window] = 0;
+        while (true) {
+            bool isDescending;
+            runBegin = findRunEnd(runBegin, windowEnd, comp, isDescending);
+            if (runBegin == windowEnd) {
+                break;
+            }
+            ++breaks[window];
+        }
+    }
+
+    std::sort(breaks, breaks + windows);
+
+    return 1 + breaks[windows / 4] * size / windowLength;
+}
+
+template <class RandomAccessIterator, class Compare, class Params>
+bool hybridRadixSort(RandomAccessIterator, RandomAccessIterator, Compare, const Params &,
+        MergeBuffer<RandomAccessIterator> &, std::false_type) {
+    return false;
+}
+
+template <class RandomAccessIterator, class Compare, class Params>
+bool hybridRadixSort(RandomAccessIterator begin, RandomAccessIterator end, Compare comp,
+        const Params &params, MergeBuffer<RandomAccessIterator> &buffer, std::true_type) {
+    typedef typename std::iterator_traits<RandomAccessIterator>::value_type ValueType;
+    const size_t minRadixSize = 1 << 10;
+    //merging pays a pass per doubling of the runs, radix a pass per key byte;
+    //measured on ints and doubles radix wins from about 2^(bytes / 2 + 1) runs
+    const size_t minRadixRuns = size_t(1) << (sizeof(typename RadixKey<ValueType>::Key) / 2 + 1);
+
+    if (!params.GetHybridRadix() || params.GetMergeMode() != MM_Buffered ||
+            static_cast<size_t>(end - begin) < minRadixSize || estimateRuns(begin, end, comp) < minRadixRuns) {
+        return false;
+    }
+
+    size_t moves = radixSort<ValueType, SimdOrder<Compare, ValueType>::isGreater>(&*begin,
+            &*begin + (end - begin), &*buffer.acquire(end - begin));
+    recordRadixSort(comp);
+    recordMoves(comp, moves);
+
+    return true;
+}
+
+//sorts contiguous ranges of arithmetic values with the default comparators by radix
+//when they have too many runs to merge cheaply; returns false when the range is left
+//to the merge engine
+template <class RandomAccessIterator, class Compare, class Params>
+bool hybridRadixSort(RandomAccessIterator begin, RandomAccessIterator end, Compare comp,
+        const Params &params, MergeBuffer<RandomAccessIterator> &buffer) {
+    return hybridRadixSort(begin, end, comp, params, buffer,
+            std::integral_constant<bool, CanRadixSort<RandomAccessIterator, Compare>::value>());
+}
+#endif
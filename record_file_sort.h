@@ -0,0 +1,133 @@
+#pragma once
+
+#ifndef RECORD_FILE_SORT_H
+#define RECORD_FILE_SORT_H
+
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "timsort.h"
+
+template <size_t size>
+struct FixedRecord {
+    unsigned char bytes[size];
+};
+
+//compares records by the Key stored at keyOffset; keys are copied out, so they need no alignment
+template <size_t size, class Key, class Compare>
+struct RecordKeyCompare {
+    size_t keyOffset;
+    Compare comp;
+
+    RecordKeyCompare(size_t keyOffset, Compare comp) : keyOffset(keyOffset), comp(comp) {}
+
+    bool operator()(const FixedRecord<size> &first, const FixedRecord<size> &second) {
+        Key firstKey, secondKey;
+        memcpy(&firstKey, first.bytes + keyOffset, sizeof(Key));
+        memcpy(&secondKey, second.bytes + keyOffset, sizeof(Key));
+        return comp(firstKey, secondKey);
+    }
+};
+
+//the engine runs directly on the mapping; run detection reads it front to back and every
+//merge streams both of its runs, so readahead pays off throughout the sort
+template <size_t size, class Key, class Compare, class Params>
+bool sortMappedRecords(void *mapping, size_t length, size_t keyOffset, Compare comp,
+        const Params &params) {
+    typedef FixedRecord<size> Record;
+
+    Record *begin = static_cast<Record*>(mapping);
+    Record *end = begin + length / size;
+    RecordKeyCompare<size, Key, Compare> recordComp(keyOffset, comp);
+
+    madvise(mapping, length, MADV_SEQUENTIAL);
+    timSort(begin, end, recordComp, params);
+
+    return msync(mapping, length, MS_SYNC) == 0;
+}
+
+template <class Key, class Compare, class Params>
+bool sortMappedRecords(void *mapping, size_t length, size_t recordSize, size_t keyOffset,
+        Compare comp, const Params &params) {
+    switch (recordSize) {
+        case 4:
+            return sortMappedRecords<4, Key>(mapping, length, keyOffset, comp, params);
+        case 8:
+            return sortMappedRecords<8, Key>(mapping, length, keyOffset, comp, params);
+        case 12:
+            return sortMappedRecords<12, Key>(mapping, length, keyOffset, comp, params);
+        case 16:
+            return sortMappedRecords<16, Key>(mapping, length, keyOffset, comp, params);
+        case 24:
+            return sortMappedRecords<24, Key>(mapping, length, keyOffset, comp, params);
+        case 32:
+            return sortMappedRecords<32, Key>(mapping, length, keyOffset, comp, params);
+        case 48:
+            return sortMappedRecords<48, Key>(mapping, length, keyOffset, comp, params);
+        case 64:
+            return sortMappedRecords<64, Key>(mapping, length, keyOffset, comp, params);
+        case 128:
+            return sortMappedRecords<128, Key>(mapping, length, keyOffset, comp, params);
+        case 256:
+            return sortMappedRecords<256, Key>(mapping, length, keyOffset, comp, params);
+    }
+
+    return false;
+}
+
+//sorts a file of fixed-size records in place by the Key at keyOffset of every record.
+//The file is mapped and sorted without copies; the default in-place merge needs no record
+//buffer, only the order of its sqrt(n) blocks, at the price of stability. Record sizes of 4, 8, 12, 16, 24, 32,
+//48, 64, 128 and 256 bytes are supported; returns false for other sizes and on I/O errors
+template <class Key, class Compare, class Params>
+typename std::enable_if<IsTimSortPolicy<Params>::value, bool>::type
+timSortFile(const std::string &path, size_t recordSize, size_t keyOffset, Compare comp,
+        const Params &params) {
+    if (keyOffset + sizeof(Key) > recordSize) {
+        return false;
+    }
+
+    int descriptor = open(path.c_str(), O_RDWR);
+    if (descriptor < 0) {
+        return false;
+    }
+
+    struct stat fileStat;
+    if (fstat(descriptor, &fileStat) != 0 || fileStat.st_size % recordSize != 0) {
+        close(descriptor);
+        return false;
+    }
+
+    size_t length = fileStat.st_size;
+    if (length == 0) {
+        close(descriptor);
+        return true;
+    }
+
+    void *mapping = mmap(0, length, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+    close(descriptor);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+
+    bool result = sortMappedRecords<Key>(mapping, length, recordSize, keyOffset, comp, params);
+
+    return munmap(mapping, length) == 0 && result;
+}
+
+template <class Key, class Compare>
+bool timSortFile(const std::string &path, size_t recordSize, size_t keyOffset, Compare comp) {
+    return timSortFile<Key>(path, recordSize, keyOffset, comp, InplaceParams());
+}
+
+template <class Key>
+bool timSortFile(const std::string &path, size_t recordSize, size_t keyOffset) {
+    return timSortFile<Key>(path, recordSize, keyOffset, LessCompare<Key>(), InplaceParams());
+}
+
+#endif
@@ -0,0 +1,243 @@
+#pragma once
+
+#ifndef RUN_DETECTION_H
+#define RUN_DETECTION_H
+
+#include <functional>
+#include <type_traits>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+//returns the end of the run starting at begin: either non-descending or strictly descending,
+//so that reversing a descending run keeps equal elements in order
+template <class RandomAccessIterator, class Compare>
+RandomAccessIterator findRunEndScalar(RandomAccessIterator begin, RandomAccessIterator end,
+        Compare comp, bool &isDescending) {
+    RandomAccessIterator runEnd = begin + 1;
+    if (runEnd == end) {
+        isDescending = false;
+        return end;
+    }
+
+    isDescending = comp(*runEnd, *begin);
+    if (isDescending) {
+        while (++runEnd != end && comp(*runEnd, *(runEnd - 1))) {
+        }
+    } else {
+        while (++runEnd != end && !comp(*runEnd, *(runEnd - 1))) {
+        }
+    }
+
+    return runEnd;
+}
+
+//lessMask(first, second) has bit i set iff first[i] < second[i]
+template <class ValueType, class Enable = void>
+struct SimdLess {
+    static const bool available = false;
+};
+
+#if defined(__AVX2__)
+template <class ValueType>
+struct SimdLess<ValueType, typename std::enable_if<std::is_integral<ValueType>::value &&
+        sizeof(ValueType) == 4 && !std::is_same<ValueType, bool>::value>::type> {
+    static const bool available = true;
+    static const ui32 width = 8;
+
+    static ui32 lessMask(const ValueType *first, const ValueType *second) {
+        __m256i bias = _mm256_set1_epi32(std::is_signed<ValueType>::value ? 0 : static_cast<int>(0x80000000u));
+        __m256i firstVector = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(first)), bias);
+        __m256i secondVector = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(second)), bias);
+        return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(secondVector, firstVector)));
+    }
+};
+
+template <class ValueType>
+struct SimdLess<ValueType, typename std::enable_if<std::is_integral<ValueType>::value &&
+        sizeof(ValueType) == 8>::type> {
+    static const bool available = true;
+    static const ui32 width = 4;
+
+    static ui32 lessMask(const ValueType *first, const ValueType *second) {
+        __m256i bias = _mm256_set1_epi64x(std::is_signed<ValueType>::value ? 0 :
+                static_cast<long long>(0x8000000000000000ull));
+        __m256i firstVector = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(first)), bias);
+        __m256i secondVector = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(second)), bias);
+        return _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(secondVector, firstVector)));
+    }
+};
+
+template <>
+struct SimdLess<float> {
+    static const bool available = true;
+    static const ui32 width = 8;
+
+    static ui32 lessMask(const float *first, const float *second) {
+        return _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(first), _mm256_loadu_ps(second), _CMP_LT_OQ));
+    }
+};
+
+template <>
+struct SimdLess<double> {
+    static const bool available = true;
+    static const ui32 width = 4;
+
+    static ui32 lessMask(const double *first, const double *second) {
+        return _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(first), _mm256_loadu_pd(second), _CMP_LT_OQ));
+    }
+};
+#elif defined(__SSE2__)
+template <class ValueType>
+struct SimdLess<ValueType, typename std::enable_if<std::is_integral<ValueType>::value &&
+        sizeof(ValueType) == 4 && !std::is_same<ValueType, bool>::value>::type> {
+    static const bool available = true;
+    static const ui32 width = 4;
+
+    static ui32 lessMask(const ValueType *first, const ValueType *second) {
+        __m128i bias = _mm_set1_epi32(std::is_signed<ValueType>::value ? 0 : static_cast<int>(0x80000000u));
+        __m128i firstVector = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(first)), bias);
+        __m128i secondVector = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(second)), bias);
+        return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(secondVector, firstVector)));
+    }
+};
+
+template <>
+struct SimdLess<float> {
+    static const bool available = true;
+    static const ui32 width = 4;
+
+    static ui32 lessMask(const float *first, const float *second) {
+        return _mm_movemask_ps(_mm_cmplt_ps(_mm_loadu_ps(first), _mm_loadu_ps(second)));
+    }
+};
+
+template <>
+struct SimdLess<double> {
+    static const bool available = true;
+    static const ui32 width = 2;
+
+    static ui32 lessMask(const double *first, const double *second) {
+        return _mm_movemask_pd(_mm_cmplt_pd(_mm_loadu_pd(first), _mm_loadu_pd(second)));
+    }
+};
+#endif
+
+//which way a comparator orders arithmetic values, if it is one the vector path understands
+template <class Compare, class ValueType>
+struct SimdOrder {
+    static const bool available = false;
+    static const bool isGreater = false;
+};
+
+template <class ValueType>
+struct SimdOrder<LessCompare<ValueType>, ValueType> {
+    static const bool available = true;
+    static const bool isGreater = false;
+};
+
+template <class ValueType>
+struct SimdOrder<std::less<ValueType>, ValueType> {
+    static const bool available = true;
+    static const bool isGreater = false;
+};
+
+template <class ValueType>
+struct SimdOrder<std::greater<ValueType>, ValueType> {
+    static const bool available = true;
+    static const bool isGreater = true;
+};
+
+template <class Compare, class ValueType>
+struct SimdOrder<StatsCompare<Compare>, ValueType> : SimdOrder<Compare, ValueType> {};
+
+template <class RandomAccessIterator>
+struct IsContiguousIterator {
+    typedef typename std::iterator_traits<RandomAccessIterator>::value_type ValueType;
+
+    static const bool value = std::is_pointer<RandomAccessIterator>::value ||
+        std::is_same<RandomAccessIterator, typename std::vector<ValueType>::iterator>::value ||
+        std::is_same<RandomAccessIterator, typename std::vector<ValueType>::const_iterator>::value;
+};
+
+template <class RandomAccessIterator, class Compare>
+struct CanFindRunsWithSimd {
+    typedef typename std::iterator_traits<RandomAccessIterator>::value_type ValueType;
+
+    static const bool value = IsContiguousIterator<RandomAccessIterator>::value &&
+        SimdLess<ValueType>::available && SimdOrder<Compare, ValueType>::available;
+};
+
+//finds the first position at or after pointer where the run breaks, i.e. where
+//comp(next, previous) is false for a descending run or true for a non-descending one
+template <class ValueType, bool isGreater>
+const ValueType* findRunBreak(const ValueType *pointer, const ValueType *end, bool isDescending) {
+    const ui32 width = SimdLess<ValueType>::width;
+    const ui32 fullMask = (1u << width) - 1;
+
+    while (end - pointer >= static_cast<long>(width)) {
+        ui32 mask = (isGreater ? SimdLess<ValueType>::lessMask(pointer - 1, pointer) :
+                SimdLess<ValueType>::lessMask(pointer, pointer - 1));
+        if (isDescending) {
+            mask = ~mask & fullMask;
+        }
+
+        if (mask) {
+            while (!(mask & 1)) {
+                mask >>= 1;
+                ++pointer;
+            }
+            return pointer;
+        }
+
+        pointer += width;
+    }
+
+    for (; pointer != end; ++pointer) {
+        bool isLess = (isGreater ? *(pointer - 1) < *pointer : *pointer < *(pointer - 1));
+        if (isLess != isDescending) {
+            break;
+        }
+    }
+
+    return pointer;
+}
+
+template <class RandomAccessIterator, class Compare>
+RandomAccessIterator findRunEnd(RandomAccessIterator begin, RandomAccessIterator end,
+        Compare comp, bool &isDescending, std::false_type) {
+    return findRunEndScalar(begin, end, comp, isDescending);
+}
+
+template <class RandomAccessIterator, class Compare>
+RandomAccessIterator findRunEnd(RandomAccessIterator begin, RandomAccessIterator end,
+        Compare comp, bool &isDescending, std::true_type) {
+    typedef typename std::iterator_traits<RandomAccessIterator>::value_type ValueType;
+
+    if (end - begin < 2) {
+        isDescending = false;
+        return end;
+    }
+
+    const ValueType *first = &*begin;
+    isDescending = comp(first[1], first[0]);
+
+    const ValueType *runEnd = findRunBreak<ValueType, SimdOrder<Compare, ValueType>::isGreater>(
+            first + 2, first + (end - begin), isDescending);
+    //one comparison per pair up to the break, the breaking pair included
+    recordComparisons(comp, (runEnd - first) - 2 + (runEnd != first + (end - begin)));
+
+    return begin + (runEnd - first);
+}
+
+//uses the vector path for contiguous ranges of arithmetic values sorted by
+//LessCompare, std::less or std::greater, the scalar loop otherwise
+template <class RandomAccessIterator, class Compare>
+RandomAccessIterator findRunEnd(RandomAccessIterator begin, RandomAccessIterator end,
+        Compare comp, bool &isDescending) {
+    return findRunEnd(begin, end, comp, isDescending,
+            std::integral_constant<bool, CanFindRunsWithSimd<RandomAccessIterator, Compare>::value>());
+}
+#endif
@@ -3,82 +3,105 @@
 #ifndef RUN_H
 #define RUN_H
 
+#include <cstddef>
+
 template <class RandomAccessIterator>
 struct RunInfo {
     RandomAccessIterator begin;
-    ui32 size;
+    size_t size;
+    //powersort power of the boundary with the run below, 0 for the bottom run
+    ui32 power;
 
     RunInfo() {}
 
-    RunInfo(RandomAccessIterator begin, ui32 size) : begin(begin), size(size) {}
+    RunInfo(RandomAccessIterator begin, size_t size, ui32 power = 0)
+        : begin(begin), size(size), power(power) {}
 };
 
+//powersort node power of the boundary between [leftBegin, leftBegin + leftSize) and the
+//following run: the first bit where the run midpoints, as fractions of total, differ
+inline ui32 boundaryPower(size_t leftBegin, size_t leftSize, size_t rightSize, size_t total) {
+    ui32 power = 0;
+    size_t left = 2 * leftBegin + leftSize;
+    size_t right = left + leftSize + rightSize;
+
+    while (true) {
+        ++power;
+        if (left >= total) {
+            left -= total;
+            right -= total;
+        } else if (right >= total) {
+            break;
+        }
+        left <<= 1;
+        right <<= 1;
+    }
+
+    return power;
+}
+
+//the merge invariant keeps run lengths growing at least like Fibonacci numbers and
+//powersort keeps the powers increasing, both bound the stack depth for 64-bit sizes;
+//a policy that breaks them has the top runs merged by the caller before the stack overflows
 template <class RandomAccessIterator>
 class RunStack {
 typedef RunInfo<RandomAccessIterator> RunType;
-private:
-
-    ui32 capacity;
-    ui32 size;
-    RunType *vector;
-
-    void shrink() {
-        if (capacity <= 4)
-            return;
-
-        capacity /= 4;
-        if (capacity < 4) {
-            capacity = 4;
-        }
+public:
 
-        RunType *newVector = new RunType[capacity];
+    static const ui32 capacity = 85;
 
-        for (ui32 pointer = 0; pointer < size; ++pointer) {
-            newVector[pointer] = vector[pointer];
-        }
+private:
 
-        delete[] vector;
-        vector = newVector;
-    }
+    ui32 size;
+    RunType vector[capacity];
 
-    void expand() {
-        capacity *= 2;
-        RunType *newVector = new RunType[capacity];
+    //the sorted range, powersort powers are positions relative to it
+    RandomAccessIterator base;
+    size_t total;
 
-        for (ui32 pointer = 0; pointer < size; ++pointer) {
-            newVector[pointer] = vector[pointer];
-        }
+public:
 
-        delete[] vector;
-        vector = newVector;
-    }
+    RunStack() : size(0), total(0) {}
 
-public:
+    RunStack(RandomAccessIterator base, size_t total) : size(0), base(base), total(total) {}
 
-    RunStack() {
-        capacity = 4;
-        size = 0;
-        vector = new RunType[capacity];
+    bool isFull() const {
+        return size == capacity;
     }
 
     void push(RunType runInfo) {
         vector[size++] = runInfo;
-
-        if (2 * size > capacity) {
-            expand();
-        }
     }
 
-    void emplace(RandomAccessIterator runBegin, ui32 runSize) {
+    void emplace(RandomAccessIterator runBegin, size_t runSize) {
         push(RunInfo<RandomAccessIterator>(runBegin, runSize));
     }
 
     void pop() {
         --size;
+    }
 
-        if (4 * size < capacity) {
-            shrink();
+    ui32 getSize() const {
+        return size;
+    }
+
+    //moves the runs to a copy of the sorted range that starts at newBase; call it while
+    //the old range is still alive
+    void rebase(RandomAccessIterator newBase, size_t newTotal) {
+        for (ui32 index = 0; index < size; ++index) {
+            vector[index].begin = newBase + (vector[index].begin - base);
         }
+
+        base = newBase;
+        total = newTotal;
+    }
+
+    ui32 getPower(const RunType &left, const RunType &right) const {
+        return boundaryPower(left.begin - base, left.size, right.size, total);
+    }
+
+    void setTopPower(ui32 power) {
+        vector[size - 1].power = power;
     }
 
     ui32 getLastThreeRuns(RunType &runX, RunType &runY, RunType &runZ) {
@@ -101,9 +124,5 @@ public:
 
         return size;
     }
-
-    virtual ~RunStack() {
-        delete[] vector;
-    }
 };
 #endif
@@ -0,0 +1,70 @@
+#pragma once
+
+#ifndef SEGMENTED_SORT_H
+#define SEGMENTED_SORT_H
+
+#include <type_traits>
+
+template <class Type>
+struct VoidType {
+    typedef void type;
+};
+
+//a segmented iterator walks a few contiguous blocks of memory: segment_begin() points to
+//its element and segment_end() past the last element of the block stored after it
+template <class RandomAccessIterator, class Enable = void>
+struct IsSegmentedIterator {
+    static const bool value = false;
+};
+
+template <class RandomAccessIterator>
+struct IsSegmentedIterator<RandomAccessIterator,
+        typename VoidType<typename RandomAccessIterator::segment_pointer>::type> {
+    static const bool value = true;
+};
+
+template <class RandomAccessIterator, class Compare, class Params>
+void timSort(RandomAccessIterator begin, RandomAccessIterator end, Compare comp,
+        const Params &params);
+
+template <class RandomAccessIterator, class Compare, class Params>
+bool sortSegmented(RandomAccessIterator, RandomAccessIterator, Compare, const Params &,
+        std::false_type) {
+    return false;
+}
+
+//every segment is sorted on raw pointers; only the final merge of the segments goes
+//through the iterators, and it is trimmed by galloping first
+template <class RandomAccessIterator, class Compare, class Params>
+bool sortSegmented(RandomAccessIterator begin, RandomAccessIterator end, Compare comp,
+        const Params &params, std::true_type) {
+    typedef typename RandomAccessIterator::segment_pointer SegmentPointer;
+
+    MergeBuffer<RandomAccessIterator> buffer;
+    RandomAccessIterator segmentBegin = begin;
+    while (segmentBegin != end) {
+        SegmentPointer first = segmentBegin.segment_begin();
+        size_t segmentSize = segmentBegin.segment_end() - first;
+        if (segmentSize > static_cast<size_t>(end - segmentBegin)) {
+            segmentSize = end - segmentBegin;
+        }
+
+        timSort(first, first + segmentSize, comp, params);
+
+        if (segmentBegin != begin) {
+            mergeRanges(begin, segmentBegin, segmentBegin + segmentSize, comp, params, buffer);
+        }
+
+        segmentBegin += segmentSize;
+    }
+
+    return true;
+}
+
+template <class RandomAccessIterator, class Compare, class Params>
+bool sortSegmented(RandomAccessIterator begin, RandomAccessIterator end, Compare comp,
+        const Params &params) {
+    return sortSegmented(begin, end, comp, params,
+            std::integral_constant<bool, IsSegmentedIterator<RandomAccessIterator>::value>());
+}
+#endif
@@ -0,0 +1,193 @@
+#pragma once
+
+#ifndef SMART_SORT_H
+#define SMART_SORT_H
+
+#include <algorithm>
+#include <cmath>
+
+#include "timsort.h"
+
+//presortedness of a range, measured by analyzeOrder
+struct OrderStats {
+    size_t size;
+    //natural runs as timSort finds them: non-descending or strictly descending
+    size_t runs;
+    //entropy of the run lengths in bits, the sum of -(length / size) log2(length / size);
+    //size * runEntropy bounds the comparisons of merging the runs
+    double runEntropy;
+    //share of the elements that are in descending runs
+    double descendingFraction;
+    //share of the adjacent pairs that are equal
+    double duplicateRatio;
+
+    OrderStats() : size(0), runs(0), runEntropy(0), descendingFraction(0), duplicateRatio(0) {}
+};
+
+//what smartSort does with a range
+enum ESortPlan {
+    SP_Sorted,
+    SP_Reverse,
+    SP_MergeRuns,
+    SP_Unadaptive
+};
+
+inline void addRunToStats(OrderStats &stats, double &lengthLogSum, size_t length, bool isDescending) {
+    ++stats.runs;
+    lengthLogSum += length * std::log2(static_cast<double>(length));
+    if (isDescending && length > 1) {
+        stats.descendingFraction += length;
+    }
+}
+
+//adds the runs of [begin, end), found by the rules of splitArrayIntoRuns, and its equal
+//adjacent pairs to the sums; at most two comparisons per pair
+template <class RandomAccessIterator, class Compare>
+void scanOrder(RandomAccessIterator begin, RandomAccessIterator end, Compare comp, OrderStats &stats,
+        double &lengthLogSum, size_t &duplicates) {
+    RandomAccessIterator runBegin = begin;
+    bool isDescending = false;
+    for (RandomAccessIterator pointer = begin + 1; pointer != end; ++pointer) {
+        bool isLess = comp(*pointer, *(pointer - 1));
+        if (!isLess && !comp(*(pointer - 1), *pointer)) {
+            ++duplicates;
+        }
+
+        if (pointer - runBegin == 1) {
+            isDescending = isLess;
+        } else if (isLess != isDescending) {
+            addRunToStats(stats, lengthLogSum, pointer - runBegin, isDescending);
+            runBegin = pointer;
+        }
+    }
+    addRunToStats(stats, lengthLogSum, end - runBegin, isDescending);
+}
+
+//turns the sums over scannedSize elements into the measures of a range of totalSize
+inline void finishOrderStats(OrderStats &stats, double lengthLogSum, size_t duplicates,
+        size_t scannedSize, size_t scannedPairs, size_t totalSize) {
+    double scanned = static_cast<double>(scannedSize);
+
+    stats.size = totalSize;
+    stats.runs = static_cast<size_t>(stats.runs * (static_cast<double>(totalSize) / scanned));
+    stats.runEntropy = std::max(0.0, std::log2(static_cast<double>(totalSize)) - lengthLogSum / scanned);
+    stats.descendingFraction /= scanned;
+    stats.duplicateRatio = scannedPairs > 0 ? duplicates / static_cast<double>(scannedPairs) : 0;
+}
+
+//measures the presortedness of [begin, end) in one pass over adjacent pairs
+template <class RandomAccessIterator, class Compare>
+OrderStats analyzeOrder(RandomAccessIterator begin, RandomAccessIterator end, Compare comp) {
+    OrderStats stats;
+    if (begin == end) {
+        return stats;
+    }
+
+    double lengthLogSum = 0;
+    size_t duplicates = 0;
+    scanOrder(begin, end, comp, stats, lengthLogSum, duplicates);
+    finishOrderStats(stats, lengthLogSum, duplicates, end - begin, end - begin - 1, end - begin);
+
+    return stats;
+}
+
+//estimates the measures of analyzeOrder from a few windows spread over the range, as
+//estimateRuns does; runs longer than a window are cut at its bounds
+template <class RandomAccessIterator, class Compare>
+OrderStats sampleOrder(RandomAccessIterator begin, RandomAccessIterator end, Compare comp) {
+    const ui32 windows = 8;
+    size_t size = end - begin;
+    size_t windowLength = std::max<size_t>(size / 128, 256);
+    if (windows * windowLength >= size) {
+        return analyzeOrder(begin, end, comp);
+    }
+
+    size_t step = (size - windowLength) / (windows - 1);
+
+    OrderStats stats;
+    double lengthLogSum = 0;
+    size_t duplicates = 0;
+    for (ui32 window = 0; window < windows; ++window) {
+        RandomAccessIterator windowBegin = begin + window * step;
+        scanOrder(windowBegin, windowBegin + windowLength, comp, stats, lengthLogSum, duplicates);
+    }
+    finishOrderStats(stats, lengthLogSum, duplicates, windows * windowLength,
+            windows * (windowLength - 1), size);
+
+    return stats;
+}
+
+//chooses between SP_MergeRuns and SP_Unadaptive for a range that is not a single run;
+//smartSort finds sorted and reversed ranges with a full scan before it samples. Merging
+//pays off once the runs are longer than minrun on average, in the entropy sense: a random
+//input has runs of two or three elements and gains nothing from run detection
+inline ESortPlan chooseSortPlan(const OrderStats &stats, size_t minrun) {
+    if (stats.runEntropy + std::log2(static_cast<double>(minrun)) <= std::log2(static_cast<double>(stats.size))) {
+        return SP_MergeRuns;
+    }
+
+    return SP_Unadaptive;
+}
+
+template <class RandomAccessIterator, class Compare, class Params>
+void unadaptiveSort(RandomAccessIterator begin, RandomAccessIterator end, Compare comp,
+        const Params &params, std::true_type) {
+    //random arithmetic values end up in the radix path of timSort
+    timSort(begin, end, comp, params);
+}
+
+template <class RandomAccessIterator, class Compare, class Params>
+void unadaptiveSort(RandomAccessIterator begin, RandomAccessIterator end, Compare comp,
+        const Params &params, std::false_type) {
+    //std::stable_sort allocates, so the in-place modes keep to timSort
+    if (params.GetMergeMode() == MM_Buffered) {
+        std::stable_sort(begin, end, comp);
+    } else {
+        timSort(begin, end, comp, params);
+    }
+}
+
+//sorts [begin, end) with the algorithm that suits its order: a sorted range is found by
+//a single vectorized scan and left alone, a descending one is reversed; for the rest the
+//order is sampled, a range with long runs is merged by timSort and a random one goes to a
+//non-adaptive kernel. The sort is stable unless the params merge in MM_Inplace mode
+template <class RandomAccessIterator, class Compare, class Params>
+ESortPlan smartSort(RandomAccessIterator begin, RandomAccessIterator end, Compare comp,
+        const Params &params) {
+    if (end - begin < 2) {
+        return SP_Sorted;
+    }
+
+    bool isDescending;
+    if (findRunEnd(begin, end, comp, isDescending) == end) {
+        if (isDescending) {
+            reverseBlock(begin, end);
+            return SP_Reverse;
+        }
+        return SP_Sorted;
+    }
+
+    ESortPlan plan = chooseSortPlan(sampleOrder(begin, end, comp), params.minRun(end - begin));
+    if (plan == SP_MergeRuns) {
+        timSort(begin, end, comp, params);
+    } else {
+        unadaptiveSort(begin, end, comp, params,
+                std::integral_constant<bool, CanRadixSort<RandomAccessIterator, Compare>::value>());
+    }
+
+    return plan;
+}
+
+template <class RandomAccessIterator, class Compare>
+typename std::enable_if<!IsTimSortPolicy<Compare>::value, ESortPlan>::type
+smartSort(RandomAccessIterator begin, RandomAccessIterator end, Compare comp) {
+    return smartSort(begin, end, comp, DefaultParams());
+}
+
+template <class RandomAccessIterator>
+ESortPlan smartSort(RandomAccessIterator begin, RandomAccessIterator end) {
+    typedef typename std::iterator_traits<RandomAccessIterator>::value_type ValueType;
+    return smartSort(begin, end, LessCompare<ValueType>(), DefaultParams());
+}
+
+#endif
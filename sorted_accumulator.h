@@ -0,0 +1,89 @@
+#pragma once
+
+#ifndef SORTED_ACCUMULATOR_H
+#define SORTED_ACCUMULATOR_H
+
+#include <vector>
+
+#include "timsort.h"
+
+//keeps a growing collection sorted by appending every batch as new runs on a persistent
+//run stack; merges happen lazily under the merge invariant, so an append costs amortized
+//O(log n) per element, and the remaining runs are collapsed only when a sorted view is
+//requested. Powersort powers depend on the final size, so the default strategy fits best
+template <class ValueType, class Compare = LessCompare<ValueType>, class Params = DefaultParams>
+class SortedAccumulator {
+private:
+
+    std::vector<ValueType> values;
+    RunStack<ValueType*> runs;
+    MergeBuffer<ValueType*> buffer;
+    Compare comp;
+    Params params;
+
+    void reserveForAppend(size_t count) {
+        if (values.size() + count <= values.capacity()) {
+            return;
+        }
+
+        size_t newCapacity = 2 * values.capacity();
+        if (newCapacity < values.size() + count) {
+            newCapacity = values.size() + count;
+        }
+
+        std::vector<ValueType> grown;
+        grown.reserve(newCapacity);
+        for (auto it = values.begin(); it != values.end(); ++it) {
+            grown.push_back(std::move(*it));
+        }
+
+        runs.rebase(grown.data(), newCapacity);
+        values.swap(grown);
+    }
+
+public:
+
+    explicit SortedAccumulator(Compare comp = Compare(), const Params &params = Params())
+        : runs(0, 0), comp(comp), params(params) {}
+
+    //[first, last) must not point into the accumulator, the storage may be reallocated
+    template <class ForwardIterator>
+    void append(ForwardIterator first, ForwardIterator last) {
+        reserveForAppend(std::distance(first, last));
+
+        size_t batchBegin = values.size();
+        for (; first != last; ++first) {
+            values.push_back(*first);
+        }
+
+        ValueType *data = values.data();
+        splitArrayIntoRuns(data + batchBegin, data + values.size(), comp, runs, params, buffer);
+    }
+
+    //value may be an element of the accumulator, so it is copied before the storage grows
+    void append(const ValueType &value) {
+        ValueType copy = value;
+        append(&copy, &copy + 1);
+    }
+
+    //collapses the pending runs; the view stays valid until the next append
+    const std::vector<ValueType>& sortedView() {
+        mergeRuns(runs, comp, params, buffer);
+        return values;
+    }
+
+    size_t size() const {
+        return values.size();
+    }
+
+    ui32 pendingRuns() const {
+        return runs.getSize();
+    }
+
+    void clear() {
+        values.clear();
+        runs = RunStack<ValueType*>(values.data(), values.capacity());
+    }
+};
+
+#endif
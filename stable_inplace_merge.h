@@ -0,0 +1,115 @@
+#pragma once
+
+#ifndef STABLE_INPLACE_MERGE_H
+#define STABLE_INPLACE_MERGE_H
+
+//moves the first occurrences of up to count distinct values of the sorted [begin, end)
+//to its front, keeping the order of the other elements; returns how many were found.
+//The keys roll forward as one block, O(n + count^2) moves in total
+template <class RandomAccessIterator, class Compare>
+size_t collectKeys(RandomAccessIterator begin, RandomAccessIterator end, size_t count, Compare comp) {
+    RandomAccessIterator keysBegin = begin;
+    size_t keysCount = 1;
+
+    for (RandomAccessIterator pointer = begin + 1; pointer != end && keysCount < count; ++pointer) {
+        if (comp(*(keysBegin + keysCount - 1), *pointer)) {
+            rotateBlocks(keysBegin, keysBegin + keysCount, pointer);
+            recordMoves(comp, 3 * (pointer - keysBegin));
+            keysBegin = pointer - keysCount;
+            ++keysCount;
+        }
+    }
+
+    rotateBlocks(begin, keysBegin, keysBegin + keysCount);
+    recordMoves(comp, 3 * (keysBegin + keysCount - begin));
+
+    return keysCount;
+}
+
+//inverse of collectKeys: the sorted keys [begin, keysEnd) go back in front of the elements
+//equal to them, which is where collectKeys took them from
+template <class RandomAccessIterator, class Compare>
+void distributeKeys(RandomAccessIterator begin, RandomAccessIterator keysEnd, RandomAccessIterator end,
+        Compare comp) {
+    while (begin != keysEnd) {
+        RandomAccessIterator position = gallopLeft(keysEnd, end, *begin, comp);
+
+        rotateBlocks(begin, keysEnd, position);
+        recordMoves(comp, 3 * (position - begin));
+
+        begin += position - keysEnd + 1;
+        keysEnd = position;
+    }
+}
+
+//mirror of gallopMerge for a short right run: [middle, end) is swapped into the buffer and
+//merged from the back, ties keep the left run first
+template <class RandomAccessIterator, class Compare>
+void swapMergeHigh(RandomAccessIterator begin, RandomAccessIterator middle, RandomAccessIterator end,
+        RandomAccessIterator buffer, Compare comp) {
+    size_t rightLength = end - middle;
+    RandomAccessIterator bufferEnd = buffer + rightLength;
+    swapBlocks(middle, end, buffer, bufferEnd);
+
+    RandomAccessIterator output = end;
+    while (buffer != bufferEnd) {
+        if (middle != begin && comp(*(bufferEnd - 1), *(middle - 1))) {
+            swapElements(*(--output), *(--middle));
+        } else {
+            swapElements(*(--output), *(--bufferEnd));
+        }
+    }
+
+    //one swap per element of the right run and per written position, three moves each
+    recordMoves(comp, 3 * (rightLength + (end - output)));
+}
+
+//SymMerge that stops splitting once the shorter run fits the buffer and finishes that
+//merge with swaps through the buffer in linear time
+template <class RandomAccessIterator, class Compare>
+void bufferedSymMerge(RandomAccessIterator begin, RandomAccessIterator middle, RandomAccessIterator end,
+        RandomAccessIterator buffer, size_t bufferLength, GallopThreshold &gallop, Compare comp) {
+    if (begin == middle || middle == end) {
+        return;
+    }
+
+    if (static_cast<size_t>(middle - begin) <= bufferLength) {
+        gallopMerge(begin, buffer, middle - begin, end - middle, gallop, comp);
+        return;
+    }
+
+    if (static_cast<size_t>(end - middle) <= bufferLength) {
+        swapMergeHigh(begin, middle, end, buffer, comp);
+        return;
+    }
+
+    RandomAccessIterator leftMiddle, rightMiddle;
+    RandomAccessIterator center = symMergeRotate(begin, middle, end, comp, leftMiddle, rightMiddle);
+
+    bufferedSymMerge(begin, leftMiddle, center, buffer, bufferLength, gallop, comp);
+    bufferedSymMerge(center, rightMiddle, end, buffer, bufferLength, gallop, comp);
+}
+
+//stable merge with O(1) extra memory in the spirit of GrailSort: up to sqrt(n) distinct
+//values of the left run become a swap buffer. Distinct values can be sorted back without
+//breaking stability, and every value returns in front of its equals. With few distinct
+//values the buffer shrinks and the merge gradually turns into a plain SymMerge
+template <class RandomAccessIterator, class Compare>
+void stableInplaceMerge(RandomAccessIterator begin, RandomAccessIterator middle, RandomAccessIterator end,
+        Compare comp, ui32 gallop) {
+    size_t shortLength = std::min(middle - begin, end - middle);
+    if (end - begin <= (1 << 16) || 8 * shortLength <= static_cast<size_t>(end - begin)) {
+        symMerge(begin, middle, end, comp);
+        return;
+    }
+
+    size_t keysCount = collectKeys(begin, middle, findBlockLength(begin, end), comp);
+    RandomAccessIterator keysEnd = begin + keysCount;
+    GallopThreshold gallopThreshold(gallop);
+
+    bufferedSymMerge(keysEnd, middle, end, begin, keysCount, gallopThreshold, comp);
+
+    binaryInsertionSort(begin, begin, keysEnd, comp);
+    distributeKeys(begin, keysEnd, end, comp);
+}
+#endif
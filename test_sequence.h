@@ -9,7 +9,26 @@
 #include <algorithm>
 #include <iostream>
 #include <iomanip>
+#include <cmath>
+#include <memory>
+#include <deque>
+#include <sys/resource.h>
+#include <chrono>
+//the parallel tests compare with std::sort(std::execution::par) when RUN_PARALLEL_STD_SORT
+//is defined before this header; libstdc++ runs it on TBB, so link with -ltbb
+#if defined(RUN_PARALLEL_STD_SORT) && __cplusplus >= 201703L
+#include <execution>
+#endif
 #include "test_generator.h"
+#include "parallel_timsort.h"
+#include "timsort_by_key.h"
+#include "deque.h"
+#include "external_sort.h"
+#include "record_file_sort.h"
+#include "sorted_accumulator.h"
+#include "multiway_merge.h"
+#include "timsort_partial.h"
+#include "smart_sort.h"
 
 template <class RandomAccessIterator>
 bool areRangesEqual(RandomAccessIterator firstBegin, RandomAccessIterator firstEnd,
@@ -56,14 +75,14 @@ void printTestMessage(bool success, ui32 testSize, ECollisionProbability collisi
     std::cout << std::endl;
 }
 
-template <class RandomAccessIterator, class Compare>
+template <class RandomAccessIterator, class Compare, class Params = DefaultParams>
 TestResult runSorts(RandomAccessIterator firstBegin, RandomAccessIterator firstEnd,
         RandomAccessIterator secondBegin, RandomAccessIterator secondEnd,
-        Compare comp) {
+        Compare comp, const Params &params = Params()) {
     TestResult result;
 
     clock_t testClock = clock();
-    timSort(firstBegin, firstEnd, comp);
+    timSort(firstBegin, firstEnd, comp, params);
     testClock = clock() - testClock;
 
     result.timSortTime = static_cast<float>(testClock) / CLOCKS_PER_SEC;
@@ -77,15 +96,15 @@ TestResult runSorts(RandomAccessIterator firstBegin, RandomAccessIterator firstE
     return result;
 }
 
-template <class DataType, class Compare = LessCompare<DataType>>
+template <class DataType, class Compare = LessCompare<DataType>, class Params = DefaultParams>
 bool runVectorTest(ui32 testSize, ECollisionProbability collisionProbability, 
-        TestGenerator &generator, Compare comp = Compare()) {
+        TestGenerator &generator, Compare comp = Compare(), const Params &params = Params()) {
     std::vector<DataType> testVector, controlVector; 
     testVector = generator.generateVectorTest<DataType>(testSize, collisionProbability);
     controlVector = testVector;
 
     TestResult sortTimes = runSorts(testVector.begin(), testVector.end(),
-        controlVector.begin(), controlVector.end(), comp);
+        controlVector.begin(), controlVector.end(), comp, params);
 
     bool result = areRangesEqual(testVector.begin(), testVector.end(), controlVector.begin(), controlVector.end());
     printTestMessage(result, testSize, collisionProbability, sortTimes);
@@ -93,9 +112,9 @@ bool runVectorTest(ui32 testSize, ECollisionProbability collisionProbability,
     return result;
 }
 
-template <class DataType, class Compare = LessCompare<DataType>>
+template <class DataType, class Compare = LessCompare<DataType>, class Params = DefaultParams>
 bool runArrayTest(ui32 testSize, ECollisionProbability collisionProbability, TestGenerator &generator,
-        Compare comp = Compare()) {
+        Compare comp = Compare(), const Params &params = Params()) {
     DataType *testArray = new DataType[testSize];
     DataType *controlArray = new DataType[testSize];
     testArray = generator.generateArrayTest<DataType>(testSize, collisionProbability);
@@ -104,7 +123,7 @@ bool runArrayTest(ui32 testSize, ECollisionProbability collisionProbability, Tes
     }
 
     TestResult sortTimes = runSorts(testArray, testArray + testSize,
-        controlArray, controlArray + testSize, comp);
+        controlArray, controlArray + testSize, comp, params);
     bool result = areRangesEqual(testArray, testArray + testSize, controlArray, controlArray + testSize);
 
     printTestMessage(result, testSize, collisionProbability, sortTimes);
@@ -115,9 +134,9 @@ bool runArrayTest(ui32 testSize, ECollisionProbability collisionProbability, Tes
     return result;
 }
 
-template <class DataType, class Compare = LessCompare<DataType>>
+template <class DataType, class Compare = LessCompare<DataType>, class Params = DefaultParams>
 bool runPartiallySortedTest(ui32 testSize, ui32 stepSize, TestGenerator &generator, 
-        Compare comp = Compare()) {
+        Compare comp = Compare(), const Params &params = Params()) {
     std::vector<DataType> testVector = generator.generateVectorTest<DataType>(testSize, CP_MEDIUM);
 
     for (ui32 pointer = 0; pointer < testVector.size(); pointer += stepSize) {
@@ -132,7 +151,7 @@ bool runPartiallySortedTest(ui32 testSize, ui32 stepSize, TestGenerator &generat
     controlVector = testVector;
 
     TestResult sortTimes = runSorts(testVector.begin(), testVector.end(),
-            controlVector.begin(), controlVector.end(), comp);
+            controlVector.begin(), controlVector.end(), comp, params);
     bool result = areRangesEqual(testVector.begin(), testVector.end(), 
             controlVector.begin(), controlVector.end());
 
@@ -141,6 +160,772 @@ bool runPartiallySortedTest(ui32 testSize, ui32 stepSize, TestGenerator &generat
     return result;
 }
 
+template <class ValueType>
+struct PointeeLessCompare {
+    bool operator()(const std::unique_ptr<ValueType> &first, const std::unique_ptr<ValueType> &second) {
+        return *first < *second;
+    }
+};
+
+//sorts move-only records; values are checked against std::sort of the same keys
+template <class DataType, class Params = DefaultParams>
+bool runMoveOnlyTest(ui32 testSize, ECollisionProbability collisionProbability,
+        TestGenerator &generator, const Params &params = Params()) {
+    std::vector<DataType> controlVector = generator.generateVectorTest<DataType>(testSize, collisionProbability);
+
+    std::vector<std::unique_ptr<DataType>> testVector;
+    for (auto it = controlVector.begin(); it != controlVector.end(); ++it) {
+        testVector.push_back(std::unique_ptr<DataType>(new DataType(*it)));
+    }
+
+    TestResult sortTimes;
+
+    clock_t testClock = clock();
+    timSort(testVector.begin(), testVector.end(), PointeeLessCompare<DataType>(), params);
+    sortTimes.timSortTime = static_cast<float>(clock() - testClock) / CLOCKS_PER_SEC;
+
+    testClock = clock();
+    std::sort(controlVector.begin(), controlVector.end());
+    sortTimes.stdSortTime = static_cast<float>(clock() - testClock) / CLOCKS_PER_SEC;
+
+    bool result = true;
+    for (ui32 pointer = 0; pointer < testSize; ++pointer) {
+        if (*testVector[pointer] != controlVector[pointer]) {
+            result = false;
+        }
+    }
+
+    printTestMessage(result, testSize, collisionProbability, sortTimes);
+
+    return result;
+}
+
+class ParallelMergeParams : public NoRadixParams<> {
+public:
+
+    static constexpr ui32 GetMergeThreads() {
+        return 4;
+    }
+
+    static constexpr size_t GetParallelMergeThreshold() {
+        return 1 << 10;
+    }
+
+};
+
+//wall-clock times, since clock() would add up the CPU time of all threads; std::sort runs
+//with the parallel execution policy under RUN_PARALLEL_STD_SORT
+template <class DataType, class Compare = LessCompare<DataType>>
+bool runParallelTest(ui32 testSize, ui32 stepSize, ui32 threads, TestGenerator &generator,
+        Compare comp = Compare()) {
+    std::vector<DataType> testVector = generator.generateVectorTest<DataType>(testSize, CP_MEDIUM);
+
+    for (ui32 pointer = 0; stepSize && pointer < testVector.size(); pointer += stepSize) {
+        std::sort(testVector.begin() + pointer,
+                testVector.begin() + std::min<ui32>(pointer + stepSize, testVector.size()), comp);
+    }
+
+    std::vector<DataType> controlVector = testVector;
+
+    TestResult sortTimes;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    parallelTimSort(testVector.begin(), testVector.end(), comp, threads);
+    sortTimes.timSortTime = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+#if defined(RUN_PARALLEL_STD_SORT) && __cplusplus >= 201703L
+    std::sort(std::execution::par, controlVector.begin(), controlVector.end(), comp);
+#else
+    std::sort(controlVector.begin(), controlVector.end(), comp);
+#endif
+    sortTimes.stdSortTime = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+
+    bool result = areRangesEqual(testVector.begin(), testVector.end(),
+            controlVector.begin(), controlVector.end());
+
+    printTestMessage(result, testSize, CP_MEDIUM, sortTimes);
+
+    return result;
+}
+
+//checks the sort and the bookkeeping of the stats: every run is counted once
+//and every merge removes exactly one run
+template <class DataType, class Params = DefaultParams>
+bool runStatsTest(ui32 testSize, ui32 stepSize, TestGenerator &generator,
+        const Params &params = Params()) {
+    std::vector<DataType> testVector = generator.generateVectorTest<DataType>(testSize, CP_MEDIUM);
+
+    for (ui32 pointer = 0; stepSize && pointer < testVector.size(); pointer += stepSize) {
+        std::sort(testVector.begin() + pointer,
+                testVector.begin() + std::min<ui32>(pointer + stepSize, testVector.size()));
+    }
+
+    std::vector<DataType> controlVector = testVector;
+    TimSortStats stats;
+
+    TestResult sortTimes;
+
+    clock_t testClock = clock();
+    timSort(testVector.begin(), testVector.end(), LessCompare<DataType>(), params, stats);
+    sortTimes.timSortTime = static_cast<float>(clock() - testClock) / CLOCKS_PER_SEC;
+
+    testClock = clock();
+    std::sort(controlVector.begin(), controlVector.end());
+    sortTimes.stdSortTime = static_cast<float>(clock() - testClock) / CLOCKS_PER_SEC;
+
+    bool result = areRangesEqual(testVector.begin(), testVector.end(),
+            controlVector.begin(), controlVector.end());
+
+    size_t histogramRuns = 0;
+    for (ui32 bucket = 0; bucket < TimSortStats::histogramSize; ++bucket) {
+        histogramRuns += stats.runLengthHistogram[bucket];
+    }
+    size_t merges = stats.merges[WM_NoMerge] + stats.merges[WM_MergeXY] + stats.merges[WM_MergeYZ];
+
+    //the radix path finds no runs and merges nothing
+    bool isMerged = stats.radixSorts == 0;
+
+    if (histogramRuns != stats.runs || stats.naturalRuns + stats.paddedRuns != stats.runs ||
+            (testSize && isMerged && merges + 1 != stats.runs) ||
+            (!isMerged && (stats.runs != 0 || merges != 0 || stats.moves < testSize)) ||
+            stats.inplaceMerges + stats.bufferedMerges > merges ||
+            (testSize > 1 && isMerged && stats.comparisons < testSize - 1)) {
+        result = false;
+    }
+
+    printTestMessage(result, testSize, CP_MEDIUM, sortTimes);
+
+    return result;
+}
+
+struct PointXKey {
+    ui32 *calls;
+
+    int operator()(const Point3D &point) {
+        ++*calls;
+        return point.x;
+    }
+};
+
+struct PointXLessCompare {
+    bool operator()(const Point3D &first, const Point3D &second) {
+        return first.x < second.x;
+    }
+};
+
+//the key is computed once per element and records with equal keys keep their order
+template <class Params = DefaultParams>
+bool runByKeyTest(ui32 testSize, ECollisionProbability collisionProbability,
+        TestGenerator &generator, const Params &params = Params()) {
+    std::vector<Point3D> testVector = generator.generateVectorTest<Point3D>(testSize, collisionProbability);
+    std::vector<Point3D> controlVector = testVector;
+
+    ui32 keyCalls = 0;
+    PointXKey keyFn;
+    keyFn.calls = &keyCalls;
+
+    TestResult sortTimes;
+
+    clock_t testClock = clock();
+    timSortByKey(testVector.begin(), testVector.end(), keyFn, LessCompare<int>(), params);
+    sortTimes.timSortTime = static_cast<float>(clock() - testClock) / CLOCKS_PER_SEC;
+
+    testClock = clock();
+    std::stable_sort(controlVector.begin(), controlVector.end(), PointXLessCompare());
+    sortTimes.stdSortTime = static_cast<float>(clock() - testClock) / CLOCKS_PER_SEC;
+
+    bool result = keyCalls == testSize && areRangesEqual(testVector.begin(), testVector.end(),
+            controlVector.begin(), controlVector.end());
+
+    printTestMessage(result, testSize, collisionProbability, sortTimes);
+
+    return result;
+}
+
+//records with equal x have to keep their order, whatever the merge mode
+template <class Params>
+bool runStabilityTest(ui32 testSize, ECollisionProbability collisionProbability,
+        TestGenerator &generator, const Params &params = Params()) {
+    std::vector<Point3D> testVector = generator.generateVectorTest<Point3D>(testSize, collisionProbability);
+    std::vector<Point3D> controlVector = testVector;
+
+    TestResult sortTimes;
+
+    clock_t testClock = clock();
+    timSort(testVector.begin(), testVector.end(), PointXLessCompare(), params);
+    sortTimes.timSortTime = static_cast<float>(clock() - testClock) / CLOCKS_PER_SEC;
+
+    testClock = clock();
+    std::stable_sort(controlVector.begin(), controlVector.end(), PointXLessCompare());
+    sortTimes.stdSortTime = static_cast<float>(clock() - testClock) / CLOCKS_PER_SEC;
+
+    bool result = areRangesEqual(testVector.begin(), testVector.end(),
+            controlVector.begin(), controlVector.end());
+
+    printTestMessage(result, testSize, collisionProbability, sortTimes);
+
+    return result;
+}
+
+//random floats go through the radix path; 0.0 and -0.0 are equal for the comparator,
+//so a stable sort has to keep them in their original order
+template <class Compare = LessCompare<float>>
+bool runSignedZeroTest(ui32 testSize, Compare comp = Compare()) {
+    std::vector<float> testVector(testSize);
+    for (ui32 pointer = 0; pointer < testSize; ++pointer) {
+        ui32 choice = rand() % 4;
+        testVector[pointer] = (choice == 0 ? -0.0f : (choice == 1 ? 0.0f :
+                    static_cast<float>(rand() - RAND_MAX / 2)));
+    }
+
+    std::vector<float> controlVector = testVector;
+
+    TestResult sortTimes;
+
+    clock_t testClock = clock();
+    timSort(testVector.begin(), testVector.end(), comp);
+    sortTimes.timSortTime = static_cast<float>(clock() - testClock) / CLOCKS_PER_SEC;
+
+    testClock = clock();
+    std::stable_sort(controlVector.begin(), controlVector.end(), comp);
+    sortTimes.stdSortTime = static_cast<float>(clock() - testClock) / CLOCKS_PER_SEC;
+
+    bool result = true;
+    for (ui32 pointer = 0; pointer < testSize; ++pointer) {
+        if (testVector[pointer] != controlVector[pointer] ||
+                std::signbit(testVector[pointer]) != std::signbit(controlVector[pointer])) {
+            result = false;
+        }
+    }
+
+    printTestMessage(result, testSize, CP_HIGH, sortTimes);
+
+    return result;
+}
+
+//elements pushed to the front wrap the ring buffer of the deque, so the sorted range
+//is split into two segments
+template <class DataType, class Compare = LessCompare<DataType>, class Params = DefaultParams>
+bool runDequeTest(ui32 testSize, ECollisionProbability collisionProbability,
+        TestGenerator &generator, Compare comp = Compare(), const Params &params = Params()) {
+    std::vector<DataType> controlVector = generator.generateVectorTest<DataType>(testSize, collisionProbability);
+
+    Deque<DataType> testDeque;
+    for (ui32 pointer = 0; pointer < testSize; ++pointer) {
+        if (pointer % 3 == 0) {
+            testDeque.push_front(controlVector[pointer]);
+        } else {
+            testDeque.push_back(controlVector[pointer]);
+        }
+    }
+    controlVector.assign(testDeque.begin(), testDeque.end());
+
+    TestResult sortTimes;
+
+    clock_t testClock = clock();
+    timSort(testDeque.begin(), testDeque.end(), comp, params);
+    sortTimes.timSortTime = static_cast<float>(clock() - testClock) / CLOCKS_PER_SEC;
+
+    testClock = clock();
+    std::stable_sort(controlVector.begin(), controlVector.end(), comp);
+    sortTimes.stdSortTime = static_cast<float>(clock() - testClock) / CLOCKS_PER_SEC;
+
+    bool result = true;
+    for (ui32 pointer = 0; pointer < testSize; ++pointer) {
+        if (testDeque[pointer] != controlVector[pointer]) {
+            result = false;
+        }
+    }
+
+    printTestMessage(result, testSize, collisionProbability, sortTimes);
+
+    return result;
+}
+
+//move-only elements need the deque to move them when it grows; the capacity stays
+//a power of two through reserve and shrink_to_fit
+bool runDequeMoveOnlyTest(ui32 testSize, TestGenerator &generator) {
+    std::vector<int> controlVector = generator.generateVectorTest<int>(testSize, CP_MEDIUM);
+
+    Deque<std::unique_ptr<int>> testDeque;
+    testDeque.reserve(testSize / 2);
+    for (ui32 pointer = 0; pointer < testSize; ++pointer) {
+        if (pointer % 2 == 0) {
+            testDeque.push_front(std::unique_ptr<int>(new int(controlVector[pointer])));
+        } else {
+            testDeque.push_back(std::unique_ptr<int>(new int(controlVector[pointer])));
+        }
+    }
+
+    TestResult sortTimes;
+
+    clock_t testClock = clock();
+    timSort(testDeque.begin(), testDeque.end(), PointeeLessCompare<int>());
+    sortTimes.timSortTime = static_cast<float>(clock() - testClock) / CLOCKS_PER_SEC;
+
+    testClock = clock();
+    std::sort(controlVector.begin(), controlVector.end());
+    sortTimes.stdSortTime = static_cast<float>(clock() - testClock) / CLOCKS_PER_SEC;
+
+    for (ui32 pointer = 0; pointer < testSize / 2; ++pointer) {
+        testDeque.pop_back();
+    }
+    testDeque.shrink_to_fit();
+
+    bool result = (testDeque.capacity() & (testDeque.capacity() - 1)) == 0 &&
+        testDeque.capacity() < 2 * testDeque.size() + 8;
+    for (ui32 pointer = 0; pointer < testDeque.size(); ++pointer) {
+        if (*testDeque[pointer] != controlVector[pointer]) {
+            result = false;
+        }
+    }
+
+    printTestMessage(result, testSize, CP_MEDIUM, sortTimes);
+
+    return result;
+}
+
+//a full deque grows on the next push, which must not lose an argument that refers to
+//one of its own elements; both ends are pushed from the opposite end
+bool runDequeSelfPushTest(ui32 testSize, TestGenerator &generator) {
+    std::vector<std::string> sourceVector = generator.generateVectorTest<std::string>(testSize, CP_MEDIUM);
+
+    Deque<std::string> testDeque;
+    std::deque<std::string> controlDeque;
+    bool pushFront = false;
+    for (ui32 pointer = 0; pointer < testSize; ++pointer) {
+        testDeque.push_back(sourceVector[pointer]);
+        controlDeque.push_back(sourceVector[pointer]);
+
+        if (testDeque.size() == testDeque.capacity()) {
+            if (pushFront) {
+                testDeque.push_front(testDeque[testDeque.size() - 1]);
+                controlDeque.push_front(controlDeque.back());
+            } else {
+                testDeque.push_back(testDeque[0]);
+                controlDeque.push_back(controlDeque.front());
+            }
+            pushFront = !pushFront;
+        }
+    }
+
+    TestResult sortTimes;
+
+    clock_t testClock = clock();
+    timSort(testDeque.begin(), testDeque.end());
+    sortTimes.timSortTime = static_cast<float>(clock() - testClock) / CLOCKS_PER_SEC;
+
+    testClock = clock();
+    std::sort(controlDeque.begin(), controlDeque.end());
+    sortTimes.stdSortTime = static_cast<float>(clock() - testClock) / CLOCKS_PER_SEC;
+
+    bool result = testDeque.size() == controlDeque.size();
+    for (ui32 pointer = 0; result && pointer < testDeque.size(); ++pointer) {
+        if (testDeque[pointer] != controlDeque[pointer]) {
+            result = false;
+        }
+    }
+
+    printTestMessage(result, testSize, CP_MEDIUM, sortTimes);
+
+    return result;
+}
+
+//writes testSize random ints to a file in the temp directory, sorts it externally and
+//checks the output while streaming it back: same count, same sum, non-descending
+bool runExternalSortTest(size_t testSize, size_t memoryBudget, ui32 fanIn, rlim_t fileLimit = 0) {
+    ExternalSortConfig config;
+    config.memoryBudget = memoryBudget;
+    config.fanIn = fanIn;
+
+    std::string inputPath = config.tempDirectory + "/timsort_external_input.bin";
+    std::string outputPath = config.tempDirectory + "/timsort_external_output.bin";
+
+    const size_t blockSize = 1 << 20;
+    std::vector<int> block;
+    unsigned long long inputSum = 0;
+
+    std::FILE *input = std::fopen(inputPath.c_str(), "wb");
+    bool result = input != 0;
+    for (size_t written = 0; result && written < testSize; written += block.size()) {
+        block.resize(std::min(blockSize, testSize - written));
+        for (auto it = block.begin(); it != block.end(); ++it) {
+            *it = rand();
+            inputSum += *it;
+        }
+        result = std::fwrite(block.data(), sizeof(int), block.size(), input) == block.size();
+    }
+    if (input) {
+        std::fclose(input);
+    }
+
+    //a low limit on open files makes the sort fail if it keeps every spilled run open
+    struct rlimit savedLimit;
+    getrlimit(RLIMIT_NOFILE, &savedLimit);
+    if (fileLimit) {
+        struct rlimit limit = savedLimit;
+        limit.rlim_cur = fileLimit;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    ExternalSortTimings timings;
+    result = result && externalSort<int>(inputPath, outputPath, LessCompare<int>(), config, &timings);
+
+    setrlimit(RLIMIT_NOFILE, &savedLimit);
+
+    unsigned long long outputSum = 0;
+    size_t outputSize = 0;
+    int previous = 0;
+
+    std::FILE *output = std::fopen(outputPath.c_str(), "rb");
+    result = result && output != 0;
+    while (result) {
+        block.resize(blockSize);
+        block.resize(std::fread(block.data(), sizeof(int), blockSize, output));
+        if (block.empty()) {
+            break;
+        }
+
+        for (auto it = block.begin(); it != block.end(); ++it) {
+            if (outputSize++ && *it < previous) {
+                result = false;
+            }
+            previous = *it;
+            outputSum += *it;
+        }
+    }
+    if (output) {
+        std::fclose(output);
+    }
+
+    result = result && outputSize == testSize && outputSum == inputSum;
+
+    std::remove(inputPath.c_str());
+    std::remove(outputPath.c_str());
+
+    TestResult sortTimes;
+    sortTimes.timSortTime = static_cast<float>(timings.sortTime);
+    sortTimes.stdSortTime = 0;
+    printTestMessage(result, testSize, CP_LOW, sortTimes);
+
+    std::cout << "\truns: " << timings.runs << "; merge passes: " << timings.mergePasses <<
+        "; read: " << timings.readTime << "s; spill: " << timings.spillTime <<
+        "s; merge: " << timings.mergeTime << "s" << std::endl << std::endl;
+
+    return result;
+}
+
+struct KeyPayloadRecord {
+    unsigned long long key;
+    unsigned long long payload;
+
+    bool operator<(const KeyPayloadRecord &other) const {
+        return key < other.key || (key == other.key && payload < other.payload);
+    }
+};
+
+//16-byte key+payload records sorted in place through a mapping; the in-place merge is not
+//stable, so records with equal keys are compared as a multiset
+template <class Params = InplaceParams>
+bool runRecordFileTest(ui32 testSize, ECollisionProbability collisionProbability,
+        TestGenerator &generator, const Params &params = Params()) {
+    std::vector<int> keys = generator.generateVectorTest<int>(testSize, collisionProbability);
+
+    std::vector<KeyPayloadRecord> controlVector(testSize);
+    for (ui32 pointer = 0; pointer < testSize; ++pointer) {
+        controlVector[pointer].key = keys[pointer];
+        controlVector[pointer].payload = pointer;
+    }
+
+    std::string path = ExternalSortConfig().tempDirectory + "/timsort_record_file.bin";
+    std::FILE *file = std::fopen(path.c_str(), "wb");
+    bool result = file != 0 &&
+        std::fwrite(controlVector.data(), sizeof(KeyPayloadRecord), testSize, file) == testSize;
+    if (file) {
+        std::fclose(file);
+    }
+
+    TestResult sortTimes;
+
+    clock_t testClock = clock();
+    result = result && timSortFile<unsigned long long>(path, sizeof(KeyPayloadRecord), 0,
+            LessCompare<unsigned long long>(), params);
+    sortTimes.timSortTime = static_cast<float>(clock() - testClock) / CLOCKS_PER_SEC;
+
+    testClock = clock();
+    std::sort(controlVector.begin(), controlVector.end());
+    sortTimes.stdSortTime = static_cast<float>(clock() - testClock) / CLOCKS_PER_SEC;
+
+    std::vector<KeyPayloadRecord> testVector(testSize);
+    file = std::fopen(path.c_str(), "rb");
+    result = result && file != 0 &&
+        std::fread(testVector.data(), sizeof(KeyPayloadRecord), testSize, file) == testSize;
+    if (file) {
+        std::fclose(file);
+    }
+    std::remove(path.c_str());
+
+    for (ui32 pointer = 1; result && pointer < testSize; ++pointer) {
+        if (testVector[pointer].key < testVector[pointer - 1].key) {
+            result = false;
+        }
+    }
+
+    std::sort(testVector.begin(), testVector.end());
+    for (ui32 pointer = 0; result && pointer < testSize; ++pointer) {
+        if (testVector[pointer].key != controlVector[pointer].key ||
+                testVector[pointer].payload != controlVector[pointer].payload) {
+            result = false;
+        }
+    }
+
+    printTestMessage(result, testSize, collisionProbability, sortTimes);
+
+    return result;
+}
+
+//appends sorted and random batches of random sizes, looking at the sorted view
+//now and then; the stack has to stay logarithmic in the number of elements. Then the
+//accumulator is cleared and refilled, and a new one is filled one element at a time,
+//every other element being a copy of its own largest value
+template <class DataType>
+bool runAccumulatorTest(ui32 testSize, ECollisionProbability collisionProbability,
+        TestGenerator &generator) {
+    std::vector<DataType> controlVector = generator.generateVectorTest<DataType>(testSize, collisionProbability);
+
+    SortedAccumulator<DataType> accumulator;
+    bool result = true;
+
+    TestResult sortTimes;
+
+    clock_t testClock = clock();
+    for (ui32 pointer = 0; pointer < testSize;) {
+        ui32 batchSize = std::min<ui32>(rand() % 1000 + 1, testSize - pointer);
+        if (rand() % 2) {
+            std::sort(controlVector.begin() + pointer, controlVector.begin() + pointer + batchSize);
+        }
+
+        accumulator.append(controlVector.begin() + pointer, controlVector.begin() + pointer + batchSize);
+        pointer += batchSize;
+
+        if (accumulator.pendingRuns() > 64) {
+            result = false;
+        }
+
+        if (rand() % 50 == 0) {
+            const std::vector<DataType> &view = accumulator.sortedView();
+            if (!std::is_sorted(view.begin(), view.end())) {
+                result = false;
+            }
+        }
+    }
+    std::vector<DataType> testVector = accumulator.sortedView();
+    sortTimes.timSortTime = static_cast<float>(clock() - testClock) / CLOCKS_PER_SEC;
+
+    testClock = clock();
+    std::sort(controlVector.begin(), controlVector.end());
+    sortTimes.stdSortTime = static_cast<float>(clock() - testClock) / CLOCKS_PER_SEC;
+
+    result = result && areRangesEqual(testVector.begin(), testVector.end(),
+            controlVector.begin(), controlVector.end());
+
+    accumulator.clear();
+    result = result && accumulator.size() == 0 && accumulator.pendingRuns() == 0 &&
+        accumulator.sortedView().empty();
+
+    accumulator.append(controlVector.rbegin(), controlVector.rend());
+    const std::vector<DataType> &refilledView = accumulator.sortedView();
+    result = result && std::equal(refilledView.begin(), refilledView.end(),
+            controlVector.begin(), controlVector.end());
+
+    SortedAccumulator<DataType> singlesAccumulator;
+    std::vector<DataType> singlesVector;
+    for (ui32 index = std::min<ui32>(testSize, 1000); index-- > 0;) {
+        singlesAccumulator.append(controlVector[index]);
+        singlesVector.push_back(controlVector[index]);
+
+        //the value is read from the storage that the append may reallocate
+        singlesAccumulator.append(singlesAccumulator.sortedView().back());
+        singlesVector.push_back(*std::max_element(singlesVector.begin(), singlesVector.end()));
+    }
+    std::sort(singlesVector.begin(), singlesVector.end());
+
+    const std::vector<DataType> &singlesView = singlesAccumulator.sortedView();
+    result = result && std::equal(singlesView.begin(), singlesView.end(),
+            singlesVector.begin(), singlesVector.end());
+
+    printTestMessage(result, testSize, collisionProbability, sortTimes);
+
+    return result;
+}
+
+//cuts the input into shards of random sizes, sorts every shard and merges them back;
+//records with equal keys have to come out in the order of the shards
+bool runMultiwayMergeTest(ui32 testSize, ui32 shardsCount, ECollisionProbability collisionProbability,
+        TestGenerator &generator) {
+    std::vector<Point3D> shardsVector = generator.generateVectorTest<Point3D>(testSize, collisionProbability);
+    std::vector<Point3D> controlVector = shardsVector;
+
+    std::vector<ui32> cuts;
+    for (ui32 index = 1; index < shardsCount; ++index) {
+        cuts.push_back(rand() % (testSize + 1));
+    }
+    cuts.push_back(0);
+    cuts.push_back(testSize);
+    std::sort(cuts.begin(), cuts.end());
+
+    typedef std::vector<Point3D>::iterator Iterator;
+    std::vector<std::pair<Iterator, Iterator>> shards;
+    for (ui32 index = 0; index + 1 < cuts.size(); ++index) {
+        Iterator begin = shardsVector.begin() + cuts[index];
+        Iterator end = shardsVector.begin() + cuts[index + 1];
+        std::stable_sort(begin, end, PointXLessCompare());
+        shards.push_back(std::make_pair(begin, end));
+    }
+
+    std::vector<Point3D> testVector(testSize);
+    TestResult sortTimes;
+
+    clock_t testClock = clock();
+    Iterator testEnd = multiwayMerge(shards, testVector.begin(), PointXLessCompare());
+    sortTimes.timSortTime = static_cast<float>(clock() - testClock) / CLOCKS_PER_SEC;
+
+    testClock = clock();
+    std::stable_sort(controlVector.begin(), controlVector.end(), PointXLessCompare());
+    sortTimes.stdSortTime = static_cast<float>(clock() - testClock) / CLOCKS_PER_SEC;
+
+    bool result = testEnd == testVector.end() && areRangesEqual(testVector.begin(), testVector.end(),
+            controlVector.begin(), controlVector.end());
+
+    printTestMessage(result, testSize, collisionProbability, sortTimes);
+
+    return result;
+}
+
+//the first topSize positions have to match std::partial_sort, the rest has to stay a
+//permutation of the input; timTopK has to agree without touching its input. The input is
+//made of sorted blocks of stepSize, descending blocks exercise the reversal of run tails
+template <class DataType>
+bool runPartialSortTest(ui32 testSize, ui32 topSize, ui32 stepSize, TestGenerator &generator,
+        bool isDescending = false) {
+    std::vector<DataType> testVector = generator.generateVectorTest<DataType>(testSize, CP_MEDIUM);
+
+    for (ui32 pointer = 0; pointer < testVector.size(); pointer += stepSize) {
+        std::sort(testVector.begin() + pointer, testVector.begin() + std::min(pointer + stepSize, testSize));
+        if (isDescending) {
+            std::reverse(testVector.begin() + pointer, testVector.begin() + std::min(pointer + stepSize, testSize));
+        }
+    }
+
+    std::vector<DataType> inputVector = testVector;
+    std::vector<DataType> controlVector = testVector;
+
+    TestResult sortTimes;
+
+    clock_t testClock = clock();
+    timPartialSort(testVector.begin(), testVector.begin() + topSize, testVector.end());
+    sortTimes.timSortTime = static_cast<float>(clock() - testClock) / CLOCKS_PER_SEC;
+
+    testClock = clock();
+    std::partial_sort(controlVector.begin(), controlVector.begin() + topSize, controlVector.end());
+    sortTimes.stdSortTime = static_cast<float>(clock() - testClock) / CLOCKS_PER_SEC;
+
+    std::vector<DataType> topVector = timTopK(inputVector.begin(), inputVector.end(), topSize);
+
+    bool result = areRangesEqual(testVector.begin(), testVector.begin() + topSize,
+            controlVector.begin(), controlVector.begin() + topSize) &&
+        areRangesEqual(topVector.begin(), topVector.end(),
+            controlVector.begin(), controlVector.begin() + topSize);
+
+    std::sort(testVector.begin(), testVector.end());
+    std::sort(controlVector.begin(), controlVector.end());
+    result = result && areRangesEqual(testVector.begin(), testVector.end(),
+            controlVector.begin(), controlVector.end());
+
+    printTestMessage(result, testSize, CP_MEDIUM, sortTimes);
+
+    return result;
+}
+
+bool isOrderStatsEqual(const OrderStats &stats, size_t size, size_t runs, double runEntropy,
+        double descendingFraction, double duplicateRatio) {
+    return stats.size == size && stats.runs == runs && std::fabs(stats.runEntropy - runEntropy) < 1e-9 &&
+        std::fabs(stats.descendingFraction - descendingFraction) < 1e-9 &&
+        std::fabs(stats.duplicateRatio - duplicateRatio) < 1e-9;
+}
+
+//exact measures of analyzeOrder on small inputs; equal neighbours end a descending run
+bool runAnalyzeOrderTest() {
+    const int ascending[] = {1, 2, 3, 4};
+    const int descending[] = {4, 3, 2, 1};
+    const int halves[] = {5, 6, 7, 8, 4, 3, 2, 1};
+    const int duplicates[] = {1, 1, 2, 2};
+    const int tiedDescending[] = {3, 2, 2, 1};
+    const int single[] = {7};
+
+    LessCompare<int> comp;
+    bool result = isOrderStatsEqual(analyzeOrder(ascending, ascending + 4, comp), 4, 1, 0, 0, 0) &&
+        isOrderStatsEqual(analyzeOrder(descending, descending + 4, comp), 4, 1, 0, 1, 0) &&
+        isOrderStatsEqual(analyzeOrder(halves, halves + 8, comp), 8, 2, 1, 0.5, 0) &&
+        isOrderStatsEqual(analyzeOrder(duplicates, duplicates + 4, comp), 4, 1, 0, 0, 2.0 / 3) &&
+        isOrderStatsEqual(analyzeOrder(tiedDescending, tiedDescending + 4, comp), 4, 2, 1, 1, 1.0 / 3) &&
+        isOrderStatsEqual(analyzeOrder(single, single + 1, comp), 1, 1, 0, 0, 0) &&
+        isOrderStatsEqual(analyzeOrder(single, single, comp), 0, 0, 0, 0, 0);
+
+    TestResult sortTimes = {0, 0};
+    printTestMessage(result, 8, CP_LOW, sortTimes);
+
+    return result;
+}
+
+//sorted blocks of stepSize points: smartSort has to pick expectedPlan on large inputs and
+//keep points with equal x in order whatever it picks
+bool runSmartSortTest(ui32 testSize, ui32 stepSize, ESortPlan expectedPlan, TestGenerator &generator) {
+    std::vector<Point3D> testVector = generator.generateVectorTest<Point3D>(testSize, CP_LOW);
+
+    for (ui32 pointer = 0; pointer < testVector.size(); pointer += stepSize) {
+        std::stable_sort(testVector.begin() + pointer, testVector.begin() + std::min(pointer + stepSize, testSize),
+                PointXLessCompare());
+    }
+
+    std::vector<Point3D> controlVector = testVector;
+
+    OrderStats stats = analyzeOrder(testVector.begin(), testVector.end(), PointXLessCompare());
+    ui32 blocks = (testSize + stepSize - 1) / stepSize;
+    bool result = stats.size == testSize && stats.runs <= 2 * blocks;
+
+    TestResult sortTimes;
+
+    clock_t testClock = clock();
+    ESortPlan plan = smartSort(testVector.begin(), testVector.end(), PointXLessCompare());
+    sortTimes.timSortTime = static_cast<float>(clock() - testClock) / CLOCKS_PER_SEC;
+
+    testClock = clock();
+    std::stable_sort(controlVector.begin(), controlVector.end(), PointXLessCompare());
+    sortTimes.stdSortTime = static_cast<float>(clock() - testClock) / CLOCKS_PER_SEC;
+
+    if (testSize >= 1024 && plan != expectedPlan) {
+        result = false;
+    }
+
+    //a strictly descending range is reversed
+    std::vector<int> reversedVector(testSize);
+    for (ui32 index = 0; index < testSize; ++index) {
+        reversedVector[index] = testSize - index;
+    }
+    if (testSize >= 2 && smartSort(reversedVector.begin(), reversedVector.end()) != SP_Reverse) {
+        result = false;
+    }
+
+    result = result && std::is_sorted(reversedVector.begin(), reversedVector.end()) &&
+        areRangesEqual(testVector.begin(), testVector.end(), controlVector.begin(), controlVector.end());
+
+    printTestMessage(result, testSize, CP_LOW, sortTimes);
+
+    return result;
+}
+
 #define RUN_VECTOR_INT_TESTS
 #define RUN_ARRAY_INT_TESTS
 #define RUN_ARRAY_INT_ASCENDING_TESTS
@@ -148,6 +933,24 @@ bool runPartiallySortedTest(ui32 testSize, ui32 stepSize, TestGenerator &generat
 #define RUN_ARRAY_OF_POINT3D_TESTS
 #define RUN_ARRAY_OF_STRING_TESTS
 #define RUN_VECTOR_PARTIALLY_SORTED_TESTS
+#define RUN_INPLACE_MERGE_TESTS
+#define RUN_STABLE_INPLACE_MERGE_TESTS
+#define RUN_MOVE_ONLY_TESTS
+#define RUN_PARALLEL_TESTS
+//with RUN_PARALLEL_STD_SORT, defined before the include, the parallel tests need -ltbb
+#define RUN_STATS_TESTS
+#define RUN_POWERSORT_TESTS
+#define RUN_BY_KEY_TESTS
+#define RUN_RADIX_TESTS
+#define RUN_DEQUE_TESTS
+#define RUN_EXTERNAL_SORT_TESTS
+#define RUN_RECORD_FILE_TESTS
+#define RUN_ACCUMULATOR_TESTS
+#define RUN_MULTIWAY_MERGE_TESTS
+#define RUN_PARTIAL_SORT_TESTS
+#define RUN_SMART_SORT_TESTS
+//writes and sorts a file of several GB in the temp directory
+//#define RUN_LARGE_EXTERNAL_SORT_TEST
 
 void runTestSequence(ui32 testsCount = 1, ui32 maxTestSize = 110000) {
     srand(0451);
@@ -165,6 +968,7 @@ void runTestSequence(ui32 testsCount = 1, ui32 maxTestSize = 110000) {
         runVectorTest<int>(*it, CP_LOW, generator);
         runVectorTest<int>(*it, CP_MEDIUM, generator);
         runVectorTest<int>(*it, CP_HIGH, generator);
+        runVectorTest<int>(*it, CP_MEDIUM, generator, LessCompare<int>(), NoRadixParams<>());
     }
 #endif
 
@@ -224,6 +1028,160 @@ void runTestSequence(ui32 testsCount = 1, ui32 maxTestSize = 110000) {
     runPartiallySortedTest<int>(4096, 1024, generator);
 #endif
 
+#ifdef RUN_INPLACE_MERGE_TESTS
+    RuntimeParams<InplaceParams> inplaceParams;
+    std::cout << "in-place merge tests:" << std::endl;
+    for (auto it = testSizes.begin(); it != testSizes.end(); ++it) {
+        runVectorTest<int>(*it, CP_LOW, generator, LessCompare<int>(), inplaceParams);
+        runVectorTest<int>(*it, CP_HIGH, generator, LessCompare<int>(), inplaceParams);
+        runArrayTest<std::string>(*it, CP_MEDIUM, generator, LessCompare<std::string>(), inplaceParams);
+    }
+    //a short run pushed onto a long one takes the rotation path, long balanced runs the blocks
+    runPartiallySortedTest<int>(200000, 190000, generator, LessCompare<int>(), inplaceParams);
+    runPartiallySortedTest<int>(300000, 150000, generator, LessCompare<int>(), inplaceParams);
+#endif
+
+#ifdef RUN_STABLE_INPLACE_MERGE_TESTS
+    std::cout << "stable in-place merge tests:" << std::endl;
+    for (auto it = testSizes.begin(); it != testSizes.end(); ++it) {
+        runStabilityTest(*it, CP_LOW, generator, StableInplaceParams());
+        runStabilityTest(*it, CP_HIGH, generator, RuntimeParams<StableInplaceParams>());
+    }
+    //long balanced runs merge through the buffer of collected keys
+    runPartiallySortedTest<int>(300000, 150000, generator, LessCompare<int>(), StableInplaceParams());
+    runStabilityTest(300000, CP_MEDIUM, generator, StableInplaceParams());
+#endif
+
+#ifdef RUN_MOVE_ONLY_TESTS
+    std::cout << "vector of unique_ptr tests:" << std::endl;
+    for (auto it = testSizes.begin(); it != testSizes.end(); ++it) {
+        runMoveOnlyTest<std::string>(*it, CP_MEDIUM, generator);
+        runMoveOnlyTest<std::string>(*it, CP_HIGH, generator, InplaceParams());
+    }
+#endif
+
+#ifdef RUN_PARALLEL_TESTS
+    std::cout << "parallel timsort tests:" << std::endl;
+    for (auto it = testSizes.begin(); it != testSizes.end(); ++it) {
+        runParallelTest<int>(*it, 0, 4, generator);
+        runParallelTest<int>(*it, *it / 3 + 1, 8, generator);
+        runVectorTest<int>(*it, CP_MEDIUM, generator, LessCompare<int>(), ParallelMergeParams());
+        runVectorTest<int>(*it, CP_HIGH, generator, LessCompare<int>(), ParallelMergeParams());
+    }
+    runParallelTest<int>(1000000, 0, 8, generator);
+    runParallelTest<int>(1000000, 100000, 8, generator);
+#endif
+
+#ifdef RUN_STATS_TESTS
+    std::cout << "timsort stats tests:" << std::endl;
+    for (auto it = testSizes.begin(); it != testSizes.end(); ++it) {
+        runStatsTest<int>(*it, 0, generator);
+        runStatsTest<int>(*it, 0, generator, NoRadixParams<>());
+        runStatsTest<int>(*it, 1000, generator);
+        runStatsTest<std::string>(*it, 100, generator, InplaceParams());
+    }
+#endif
+
+#ifdef RUN_POWERSORT_TESTS
+    std::cout << "powersort merge strategy tests:" << std::endl;
+    for (auto it = testSizes.begin(); it != testSizes.end(); ++it) {
+        runVectorTest<int>(*it, CP_MEDIUM, generator, LessCompare<int>(), NoRadixParams<PowersortParams>());
+        runArrayTest<std::string>(*it, CP_HIGH, generator, LessCompare<std::string>(), PowersortParams());
+        runStatsTest<int>(*it, 20, generator, NoRadixParams<PowersortParams>());
+        runStatsTest<int>(*it, *it / 7 + 1, generator, NoRadixParams<PowersortParams>());
+    }
+#endif
+
+#ifdef RUN_BY_KEY_TESTS
+    std::cout << "sort by key tests:" << std::endl;
+    for (auto it = testSizes.begin(); it != testSizes.end(); ++it) {
+        runByKeyTest(*it, CP_LOW, generator);
+        runByKeyTest(*it, CP_HIGH, generator, PowersortParams());
+        runByKeyTest(*it, CP_HIGH, generator, InplaceParams());
+    }
+#endif
+
+#ifdef RUN_RADIX_TESTS
+    std::cout << "hybrid radix tests:" << std::endl;
+    for (auto it = testSizes.begin(); it != testSizes.end(); ++it) {
+        runSignedZeroTest(*it);
+        runSignedZeroTest(*it, std::greater<float>());
+    }
+#endif
+
+#ifdef RUN_DEQUE_TESTS
+    std::cout << "deque tests:" << std::endl;
+    for (auto it = testSizes.begin(); it != testSizes.end(); ++it) {
+        runDequeTest<int>(*it, CP_LOW, generator);
+        runDequeTest<int>(*it, CP_HIGH, generator, std::greater<int>());
+        runDequeTest<std::string>(*it, CP_MEDIUM, generator);
+        runDequeTest<int>(*it, CP_MEDIUM, generator, LessCompare<int>(), InplaceParams());
+        runDequeMoveOnlyTest(*it, generator);
+        runDequeSelfPushTest(*it, generator);
+    }
+#endif
+
+#ifdef RUN_EXTERNAL_SORT_TESTS
+    std::cout << "external sort tests:" << std::endl;
+    for (auto it = testSizes.begin(); it != testSizes.end(); ++it) {
+        runExternalSortTest(*it, 1 << 20, 16);
+        runExternalSortTest(*it, 1 << 16, 3);
+    }
+    runExternalSortTest(300000, 1 << 12, 4, 32);
+#endif
+
+#ifdef RUN_RECORD_FILE_TESTS
+    std::cout << "memory-mapped record file tests:" << std::endl;
+    for (auto it = testSizes.begin(); it != testSizes.end(); ++it) {
+        runRecordFileTest(*it, CP_LOW, generator);
+        runRecordFileTest(*it, CP_HIGH, generator, DefaultParams());
+    }
+#endif
+
+#ifdef RUN_ACCUMULATOR_TESTS
+    std::cout << "sorted accumulator tests:" << std::endl;
+    for (auto it = testSizes.begin(); it != testSizes.end(); ++it) {
+        runAccumulatorTest<int>(*it, CP_MEDIUM, generator);
+        runAccumulatorTest<std::string>(*it, CP_HIGH, generator);
+    }
+#endif
+
+#ifdef RUN_MULTIWAY_MERGE_TESTS
+    std::cout << "multiway merge tests:" << std::endl;
+    for (auto it = testSizes.begin(); it != testSizes.end(); ++it) {
+        runMultiwayMergeTest(*it, 2, CP_HIGH, generator);
+        runMultiwayMergeTest(*it, 13, CP_MEDIUM, generator);
+        runMultiwayMergeTest(*it, 200, CP_HIGH, generator);
+    }
+#endif
+
+#ifdef RUN_PARTIAL_SORT_TESTS
+    std::cout << "partial sort tests:" << std::endl;
+    for (auto it = testSizes.begin(); it != testSizes.end(); ++it) {
+        runPartialSortTest<int>(*it, 10, 1, generator);
+        runPartialSortTest<int>(*it, *it / 10, 1000, generator);
+        runPartialSortTest<std::string>(*it, *it / 3, *it / 4 + 1, generator);
+        runPartialSortTest<int>(*it, 10, 1000, generator, true);
+        runPartialSortTest<int>(*it, *it / 10, *it + 1, generator, true);
+        runPartialSortTest<int>(*it, *it - *it / 8, 100, generator);
+    }
+#endif
+
+#ifdef RUN_SMART_SORT_TESTS
+    std::cout << "smart sort tests:" << std::endl;
+    runAnalyzeOrderTest();
+    for (auto it = testSizes.begin(); it != testSizes.end(); ++it) {
+        runSmartSortTest(*it, 1, SP_Unadaptive, generator);
+        runSmartSortTest(*it, *it / 8 + 1, SP_MergeRuns, generator);
+        runSmartSortTest(*it, *it + 1, SP_Sorted, generator);
+    }
+#endif
+
+#ifdef RUN_LARGE_EXTERNAL_SORT_TEST
+    std::cout << "large external sort test:" << std::endl;
+    runExternalSortTest(size_t(1) << 30, size_t(256) << 20, 16);
+#endif
+
 }
 
 #endif
@@ -3,6 +3,7 @@
 #ifndef TIMSORT_H
 #define TIMSORT_H
 
+#include <cstddef>
 #include <iterator>
 
 typedef unsigned int ui32;
@@ -10,31 +11,81 @@ typedef unsigned int ui32;
 #include "timsort_params.h"
 #include "runs.h"
 #include "compare.h"
+#include "timsort_stats.h"
+#include "run_detection.h"
 #include "block_algorithms.h"
 #include "insertion_sort.h"
 #include "inplace_merge.h"
+#include "stable_inplace_merge.h"
+#include "merge_buffer.h"
+#include "radix_sort.h"
+#include "buffered_merge.h"
+#include "merge.h"
+#include "parallel_merge.h"
+#include "segmented_sort.h"
+
+template <class RandomAccessIterator, class Compare, class Params>
+void mergeAdjacentRuns(RunInfo<RandomAccessIterator> runY, RunInfo<RandomAccessIterator> runX,
+        Compare comp, const Params &params, MergeBuffer<RandomAccessIterator> &buffer) {
+    RandomAccessIterator end = runX.begin + runX.size;
+
+    if (params.GetMergeThreads() > 1 && runY.size + runX.size >= params.GetParallelMergeThreshold()) {
+        parallelMerge(runY.begin, runX.begin, end, comp, params, params.GetMergeThreads());
+    } else {
+        mergeRanges(runY.begin, runX.begin, end, comp, params, buffer);
+    }
+}
 
-template <class RandomAccessIterator, class Compare>
+template <class RandomAccessIterator, class Compare, class Params>
 void mergeXY(RunInfo<RandomAccessIterator> runX, RunInfo<RandomAccessIterator> runY,
-        RunStack<RandomAccessIterator> &runs, Compare comp, const ITimSortParams &params) {
-    inplaceMerge(runY.begin, runX.begin, runX.begin + runX.size, comp, params.GetGallop());
+        RunStack<RandomAccessIterator> &runs, Compare comp, const Params &params,
+        MergeBuffer<RandomAccessIterator> &buffer) {
+    mergeAdjacentRuns(runY, runX, comp, params, buffer);
     runs.pop();
     runs.pop();
-    runs.emplace(runY.begin, runY.size + runX.size);
+    runY.size += runX.size;
+    runs.push(runY);
 }
 
-template <class RandomAccessIterator, class Compare>
+template <class RandomAccessIterator, class Compare, class Params>
 void mergeYZ(RunInfo<RandomAccessIterator> runX, RunInfo<RandomAccessIterator> runY,
         RunInfo<RandomAccessIterator> runZ, RunStack<RandomAccessIterator> &runs, 
-        Compare comp, const ITimSortParams &params) {
+        Compare comp, const Params &params, MergeBuffer<RandomAccessIterator> &buffer) {
     runs.pop();
-    mergeXY(runY, runZ, runs, comp, params);
-    runs.emplace(runX.begin, runX.size);
+    mergeXY(runY, runZ, runs, comp, params, buffer);
+    runs.push(runX);
 }
 
-template <class RandomAccessIterator, class Compare>
+//the new run X gets the power of its boundary with Y; runs below a boundary of a higher
+//power are merged first, so the stack keeps the powers increasing
+template <class RandomAccessIterator, class Compare, class Params>
+void supportPowerInvariant(RunStack<RandomAccessIterator> &runs,
+        Compare comp, const Params &params, MergeBuffer<RandomAccessIterator> &buffer) {
+    RunInfo<RandomAccessIterator> runX, runY, runZ;
+
+    ui32 runsCount = runs.getLastThreeRuns(runX, runY, runZ);
+    if (runsCount < 2) {
+        return;
+    }
+
+    runX.power = runs.getPower(runY, runX);
+    runs.setTopPower(runX.power);
+
+    while (runsCount >= 3 && runY.power > runX.power) {
+        recordMerge(comp, WM_MergeYZ);
+        mergeYZ(runX, runY, runZ, runs, comp, params, buffer);
+        runsCount = runs.getLastThreeRuns(runX, runY, runZ);
+    }
+}
+
+template <class RandomAccessIterator, class Compare, class Params>
 void supportInvariant(RunStack<RandomAccessIterator> &runs,
-        Compare comp, const ITimSortParams &params) {
+        Compare comp, const Params &params, MergeBuffer<RandomAccessIterator> &buffer) {
+    if (params.GetMergeStrategy() == MS_Powersort) {
+        supportPowerInvariant(runs, comp, params, buffer);
+        return;
+    }
+
     RunInfo<RandomAccessIterator> runX, runY, runZ;
 
     bool needMerge = true;
@@ -42,10 +93,12 @@ void supportInvariant(RunStack<RandomAccessIterator> &runs,
     while (runsCount >= 3 && needMerge) {
         switch (params.whatMerge(runX.size, runY.size, runZ.size)) {
             case WM_MergeXY:
-                mergeXY(runX, runY, runs, comp, params);
+                recordMerge(comp, WM_MergeXY);
+                mergeXY(runX, runY, runs, comp, params, buffer);
                 break;
             case WM_MergeYZ:
-                mergeYZ(runX, runY, runZ, runs, comp, params);
+                recordMerge(comp, WM_MergeYZ);
+                mergeYZ(runX, runY, runZ, runs, comp, params, buffer);
                break;
             case WM_NoMerge:
                 needMerge = false;
@@ -57,57 +110,60 @@ void supportInvariant(RunStack<RandomAccessIterator> &runs,
 
     if (runsCount == 2) {
         if (params.needMerge(runX.size, runY.size)) {
-            mergeXY(runX, runY, runs, comp, params);
+            recordMerge(comp, WM_MergeXY);
+            mergeXY(runX, runY, runs, comp, params, buffer);
         }
     }
 }
 
-template <class RandomAccessIterator, class Compare>
+template <class RandomAccessIterator, class Compare, class Params>
 void splitArrayIntoRuns(RandomAccessIterator begin, RandomAccessIterator end, Compare comp,
-        RunStack<RandomAccessIterator> &runs, const ITimSortParams &params) {
-    ui32 minrun = params.minRun(end - begin);
+        RunStack<RandomAccessIterator> &runs, const Params &params,
+        MergeBuffer<RandomAccessIterator> &buffer) {
+    size_t minrun = params.minRun(end - begin);
 
     for (RandomAccessIterator runBegin = begin; runBegin != end;) {
-        RandomAccessIterator runEnd = runBegin + 1;
-
-        while (runEnd != end && areEqual(runEnd, runEnd - 1, comp)) {
-            ++runEnd;
-        }
-
-        bool isDescending = (runEnd == end ? false : comp(*runEnd, *runBegin));
-
-        while (runEnd != end && 
-                ((isDescending ? comp(*runEnd, *(runEnd - 1)) : comp(*(runEnd - 1), *runEnd)) ||
-            areEqual(runEnd, runEnd - 1, comp))) {
-            ++runEnd;
-        }
+        bool isDescending;
+        RandomAccessIterator runEnd = findRunEnd(runBegin, end, comp, isDescending);
 
         if (isDescending) {
             reverseBlock(runBegin, runEnd);
+            recordMoves(comp, 3 * ((runEnd - runBegin) / 2));
         }
 
-        while (runEnd != end && runEnd - runBegin < minrun) {
+        RandomAccessIterator naturalEnd = runEnd;
+        while (runEnd != end && static_cast<size_t>(runEnd - runBegin) < minrun) {
             ++runEnd;
         }
 
-        insertionSort(runBegin, runEnd, comp);
+        binaryInsertionSort(runBegin, naturalEnd, runEnd, comp);
+        recordRun(comp, naturalEnd - runBegin, runEnd - runBegin);
+
+        //only a policy that breaks the merge invariant fills the stack
+        if (runs.isFull()) {
+            RunInfo<RandomAccessIterator> runX, runY, runZ;
+            runs.getLastThreeRuns(runX, runY, runZ);
+            recordMerge(comp, WM_MergeXY);
+            mergeXY(runX, runY, runs, comp, params, buffer);
+        }
 
         runs.emplace(runBegin, runEnd - runBegin);
 
-        supportInvariant(runs, comp, params);
+        supportInvariant(runs, comp, params, buffer);
 
         runBegin = runEnd;
     }
 }
 
-template <class RandomAccessIterator, class Compare>
+template <class RandomAccessIterator, class Compare, class Params>
 void mergeRuns(RunStack<RandomAccessIterator> &runs, Compare comp,
-        const ITimSortParams &params) {
+        const Params &params, MergeBuffer<RandomAccessIterator> &buffer) {
     RunInfo<RandomAccessIterator> runX, runY, runZ;
     ui32 runsCount = runs.getLastThreeRuns(runX, runY, runZ);
 
     while (runsCount > 1) {
-        inplaceMerge(runY.begin, runX.begin, runX.begin + runX.size, comp, params.GetGallop());
+        recordMerge(comp, WM_NoMerge);
+        mergeAdjacentRuns(runY, runX, comp, params, buffer);
 
         runs.pop();
         runs.pop();
@@ -117,23 +173,62 @@ void mergeRuns(RunStack<RandomAccessIterator> &runs, Compare comp,
     }
 }
 
-template <class RandomAccessIterator, class Compare>
+template <class RandomAccessIterator, class Compare, class Params>
 void timSort(RandomAccessIterator begin, RandomAccessIterator end, Compare comp, 
-        const ITimSortParams &params = DefaultParams()) {
+        const Params &params) {
 
-    RunStack<RandomAccessIterator> runs;
+    if (sortSegmented(begin, end, comp, params)) {
+        return;
+    }
+
+    RunStack<RandomAccessIterator> runs(begin, end - begin);
+    MergeBuffer<RandomAccessIterator> buffer;
 
-    splitArrayIntoRuns(begin, end, comp, runs, params);
+    if (hybridRadixSort(begin, end, comp, params, buffer)) {
+        return;
+    }
 
-    mergeRuns(runs, comp, params);
+    splitArrayIntoRuns(begin, end, comp, runs, params, buffer);
+
+    mergeRuns(runs, comp, params, buffer);
 
 }
 
-template <class RandomAccessIterator>
-void timSort(RandomAccessIterator first, RandomAccessIterator last,
-        const ITimSortParams &params = DefaultParams()) {
+//fills stats for this call; a comparator without the stats wrapper pays nothing for the hooks
+template <class RandomAccessIterator, class Compare, class Params>
+void timSort(RandomAccessIterator begin, RandomAccessIterator end, Compare comp,
+        const Params &params, TimSortStats &stats) {
+    timSort(begin, end, StatsCompare<Compare>(comp, &stats), params);
+}
+
+template <class RandomAccessIterator, class Compare>
+typename std::enable_if<!IsTimSortPolicy<Compare>::value>::type
+timSort(RandomAccessIterator begin, RandomAccessIterator end, Compare comp) {
+    timSort(begin, end, comp, DefaultParams());
+}
+
+template <class RandomAccessIterator, class Params>
+typename std::enable_if<IsTimSortPolicy<Params>::value>::type
+timSort(RandomAccessIterator first, RandomAccessIterator last, const Params &params) {
     timSort(first, last, LessCompare<typename std::iterator_traits<RandomAccessIterator>::value_type>(), params);
 }
 
+template <class RandomAccessIterator>
+void timSort(RandomAccessIterator first, RandomAccessIterator last) {
+    timSort(first, last, DefaultParams());
+}
+
+//timSort<Policy>(begin, end[, comp])
+template <class Params, class RandomAccessIterator, class Compare>
+typename std::enable_if<IsTimSortPolicy<Params>::value>::type
+timSort(RandomAccessIterator begin, RandomAccessIterator end, Compare comp) {
+    timSort(begin, end, comp, Params());
+}
+
+template <class Params, class RandomAccessIterator>
+typename std::enable_if<IsTimSortPolicy<Params>::value>::type
+timSort(RandomAccessIterator first, RandomAccessIterator last) {
+    timSort(first, last, Params());
+}
 
 #endif
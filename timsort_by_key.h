@@ -0,0 +1,86 @@
+#pragma once
+
+#ifndef TIMSORT_BY_KEY_H
+#define TIMSORT_BY_KEY_H
+
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "timsort.h"
+
+//orders by key and equal keys by their original index, so the sort is stable even
+//when the merge mode is not
+template <class Key, class KeyCompare>
+struct KeyIndexCompare {
+    KeyCompare comp;
+
+    explicit KeyIndexCompare(KeyCompare comp) : comp(comp) {}
+
+    bool operator()(const std::pair<Key, size_t> &first, const std::pair<Key, size_t> &second) {
+        if (comp(first.first, second.first)) {
+            return true;
+        }
+        if (comp(second.first, first.first)) {
+            return false;
+        }
+        return first.second < second.second;
+    }
+};
+
+//order[i] is the position the element that belongs at i comes from; every cycle
+//of the permutation is rotated through a single temporary
+template <class RandomAccessIterator, class Key>
+void applyPermutation(RandomAccessIterator begin, std::vector<std::pair<Key, size_t>> &order) {
+    typedef typename std::iterator_traits<RandomAccessIterator>::value_type ValueType;
+
+    for (size_t start = 0; start < order.size(); ++start) {
+        if (order[start].second == start) {
+            continue;
+        }
+
+        ValueType value = std::move(*(begin + start));
+        size_t current = start;
+        while (order[current].second != start) {
+            size_t next = order[current].second;
+            *(begin + current) = std::move(*(begin + next));
+            order[current].second = current;
+            current = next;
+        }
+        *(begin + current) = std::move(value);
+        order[current].second = current;
+    }
+}
+
+//sorts by keyFn(element) stably under any policy, calling keyFn once per element: the
+//(key, index) pairs are sorted and the records are moved into place afterwards
+template <class RandomAccessIterator, class KeyFunction, class KeyCompare, class Params>
+void timSortByKey(RandomAccessIterator begin, RandomAccessIterator end, KeyFunction keyFn,
+        KeyCompare keyComp, const Params &params) {
+    typedef typename std::decay<decltype(keyFn(*begin))>::type Key;
+
+    std::vector<std::pair<Key, size_t>> keys;
+    keys.reserve(end - begin);
+    for (RandomAccessIterator pointer = begin; pointer != end; ++pointer) {
+        keys.push_back(std::pair<Key, size_t>(keyFn(*pointer), keys.size()));
+    }
+
+    timSort(keys.begin(), keys.end(), KeyIndexCompare<Key, KeyCompare>(keyComp), params);
+
+    applyPermutation(begin, keys);
+}
+
+template <class RandomAccessIterator, class KeyFunction, class KeyCompare>
+void timSortByKey(RandomAccessIterator begin, RandomAccessIterator end, KeyFunction keyFn,
+        KeyCompare keyComp) {
+    timSortByKey(begin, end, keyFn, keyComp, DefaultParams());
+}
+
+template <class RandomAccessIterator, class KeyFunction>
+void timSortByKey(RandomAccessIterator begin, RandomAccessIterator end, KeyFunction keyFn) {
+    typedef typename std::decay<decltype(keyFn(*begin))>::type Key;
+
+    timSortByKey(begin, end, keyFn, LessCompare<Key>(), DefaultParams());
+}
+
+#endif
@@ -3,67 +3,196 @@
 #ifndef TIMSORT_PARAMS
 #define TIMSORT_PARAMS
 
+#include <type_traits>
+
 enum EWhatMerge {
     WM_NoMerge,
     WM_MergeXY,
     WM_MergeYZ
 };
 
-class ITimSortParams {
+enum EMergeMode {
+    MM_Inplace,
+    MM_Buffered,
+    MM_StableInplace
+};
+
+enum EMergeStrategy {
+    MS_WhatMerge,
+    MS_Powersort
+};
+
+//base of every parameter policy, lets the timSort overloads tell a policy from a comparator
+struct TimSortPolicy {};
+
+template <class Type>
+struct IsTimSortPolicy {
+    static const bool value = std::is_base_of<TimSortPolicy, Type>::value;
+};
+
+//runtime interface for callers that tune the parameters dynamically;
+//every rule costs a virtual call
+class ITimSortParams : public TimSortPolicy {
 public:
 
-    virtual ui32 minRun(ui32 coun) const = 0;
+    virtual size_t minRun(size_t coun) const = 0;
 
-    virtual bool needMerge(ui32 lenX, ui32 lenY) const = 0;
+    virtual bool needMerge(size_t lenX, size_t lenY) const = 0;
 
-    virtual EWhatMerge whatMerge(ui32 lenX, ui32 lenY, ui32 lenZ) const = 0;
+    virtual EWhatMerge whatMerge(size_t lenX, size_t lenY, size_t lenZ) const = 0;
 
     virtual ui32 GetGallop() const = 0;
 
+    virtual EMergeStrategy GetMergeStrategy() const = 0;
+
+    virtual EMergeMode GetMergeMode() const = 0;
+
+    virtual ui32 GetMergeThreads() const = 0;
+
+    virtual size_t GetParallelMergeThreshold() const = 0;
+
+    virtual bool GetHybridRadix() const = 0;
+
+    virtual ~ITimSortParams() {}
+
 };
 
-class DefaultParams : public ITimSortParams {
+//the default compile-time policy: the engine is instantiated for the policy type,
+//so its rules are inlined and constant-folded; derive from it and hide a rule to change it
+class DefaultParams : public TimSortPolicy {
 public:
 
-    virtual ui32 minRun(ui32 count) const;
+    static constexpr size_t minRun(size_t count, size_t addBit = 0) {
+        return count >= 64 ? minRun(count >> 1, addBit | (count & 1)) : count + addBit;
+    }
+
+    static constexpr bool needMerge(size_t lenX, size_t lenY) {
+        return lenY <= lenX;
+    }
+
+    static constexpr EWhatMerge whatMerge(size_t lenX, size_t lenY, size_t lenZ) {
+        return (lenZ > lenX + lenY && lenY > lenX) ? WM_NoMerge :
+            (lenX < lenZ ? WM_MergeXY : WM_MergeYZ);
+    }
 
-    virtual bool needMerge(ui32 lenX, ui32 lenY) const;
+    static constexpr ui32 GetGallop() {
+        return 7;
+    }
 
-    virtual EWhatMerge whatMerge(ui32 lenX, ui32 lenY, ui32 lenZ) const;
+    //MS_Powersort replaces needMerge and whatMerge by the powersort rule
+    static constexpr EMergeStrategy GetMergeStrategy() {
+        return MS_WhatMerge;
+    }
 
-    virtual ui32 GetGallop() const;
+    static constexpr EMergeMode GetMergeMode() {
+        return MM_Buffered;
+    }
+
+    static constexpr ui32 GetMergeThreads() {
+        return 1;
+    }
+
+    static constexpr size_t GetParallelMergeThreshold() {
+        return 1 << 16;
+    }
+
+    //buffered sorts of arithmetic values with the default comparators switch to a stable
+    //radix sort when sampling finds the input too run-poor for merging to pay off
+    static constexpr bool GetHybridRadix() {
+        return true;
+    }
 
 };
 
-ui32 DefaultParams::minRun(ui32 count) const {
-    ui32 addBit = 0;
+//keeps the O(1)-extra-memory block merge for memory-constrained callers
+class InplaceParams : public DefaultParams {
+public:
 
-    while (count >= 4) {
-        addBit |= count & 1;
-        count >>= 1;
+    static constexpr EMergeMode GetMergeMode() {
+        return MM_Inplace;
     }
 
-    return count + addBit;
-}
+};
 
-bool DefaultParams::needMerge(ui32 lenX, ui32 lenY) const {
-    return lenY <= lenX;
-}
+//stable merges with O(1) extra memory; with many distinct values the swap buffer makes them
+//faster than the unstable MM_Inplace, and about 1.8 times slower than MM_Buffered
+class StableInplaceParams : public DefaultParams {
+public:
 
-EWhatMerge DefaultParams::whatMerge(ui32 lenX, ui32 lenY, ui32 lenZ) const {
-    if (lenZ > lenX + lenY && lenY > lenX) {
-        return WM_NoMerge;
-    } else if (lenX < lenZ) {
-        return WM_MergeXY;
-    } else {
-        return WM_MergeYZ;
+    static constexpr EMergeMode GetMergeMode() {
+        return MM_StableInplace;
     }
-}
 
-ui32 DefaultParams::GetGallop() const {
-    return 7;
-}
+};
 
-#endif
+//merges runs by the powersort node power of their boundaries, as CPython 3.11 does;
+//the merge tree is within a few percent of optimal for any run length pattern
+class PowersortParams : public DefaultParams {
+public:
 
+    static constexpr EMergeStrategy GetMergeStrategy() {
+        return MS_Powersort;
+    }
+
+};
+
+//Policy with the hybrid radix path turned off, so arithmetic inputs always go through
+//the merge engine; meant for measuring and testing the merges themselves
+template <class Policy = DefaultParams>
+class NoRadixParams : public Policy {
+public:
+
+    static constexpr bool GetHybridRadix() {
+        return false;
+    }
+
+};
+
+//adapts a compile-time policy to ITimSortParams; override the rules to tune at runtime
+template <class Policy = DefaultParams>
+class RuntimeParams : public ITimSortParams {
+private:
+
+    Policy policy;
+
+public:
+
+    virtual size_t minRun(size_t count) const {
+        return policy.minRun(count);
+    }
+
+    virtual bool needMerge(size_t lenX, size_t lenY) const {
+        return policy.needMerge(lenX, lenY);
+    }
 
+    virtual EWhatMerge whatMerge(size_t lenX, size_t lenY, size_t lenZ) const {
+        return policy.whatMerge(lenX, lenY, lenZ);
+    }
+
+    virtual ui32 GetGallop() const {
+        return policy.GetGallop();
+    }
+
+    virtual EMergeStrategy GetMergeStrategy() const {
+        return policy.GetMergeStrategy();
+    }
+
+    virtual EMergeMode GetMergeMode() const {
+        return policy.GetMergeMode();
+    }
+
+    virtual ui32 GetMergeThreads() const {
+        return policy.GetMergeThreads();
+    }
+
+    virtual size_t GetParallelMergeThreshold() const {
+        return policy.GetParallelMergeThreshold();
+    }
+
+    virtual bool GetHybridRadix() const {
+        return policy.GetHybridRadix();
+    }
+
+};
+
+#endif
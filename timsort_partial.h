@@ -0,0 +1,196 @@
+#pragma once
+
+#ifndef TIMSORT_PARTIAL_H
+#define TIMSORT_PARTIAL_H
+
+#include <vector>
+
+#include "timsort.h"
+
+template <class RandomAccessIterator, class Compare, class Params>
+void pushZoneRun(RunStack<RandomAccessIterator> &runs, RandomAccessIterator runBegin, size_t runSize,
+        Compare comp, const Params &params, MergeBuffer<RandomAccessIterator> &buffer) {
+    if (runs.isFull()) {
+        RunInfo<RandomAccessIterator> runX, runY, runZ;
+        runs.getLastThreeRuns(runX, runY, runZ);
+        recordMerge(comp, WM_MergeXY);
+        mergeXY(runX, runY, runs, comp, params, buffer);
+    }
+
+    runs.emplace(runBegin, runSize);
+    supportInvariant(runs, comp, params, buffer);
+}
+
+//sorts the pending candidates at zoneEnd and pushes them as one run
+template <class RandomAccessIterator, class Compare, class Params>
+void pushPendingRun(RunStack<RandomAccessIterator> &runs, RandomAccessIterator &zoneEnd, size_t &pending,
+        Compare comp, const Params &params, MergeBuffer<RandomAccessIterator> &buffer) {
+    if (pending == 0) {
+        return;
+    }
+
+    binaryInsertionSort(zoneEnd, zoneEnd, zoneEnd + pending, comp);
+    recordRun(comp, 1, pending);
+    pushZoneRun(runs, zoneEnd, pending, comp, params, buffer);
+
+    zoneEnd += pending;
+    pending = 0;
+}
+
+//moves count candidates from source to destination; the elements they displace are not needed
+template <class RandomAccessIterator, class Compare>
+void moveCandidates(RandomAccessIterator destination, RandomAccessIterator source, size_t count, Compare comp) {
+    if (destination != source) {
+        swapBlocks(destination, destination + count, source, source + count);
+        recordMoves(comp, 3 * count);
+    }
+}
+
+//puts the middle - begin smallest elements of [begin, end) in order into [begin, middle);
+//the rest of the range is left in unspecified order. Runs are found as in timSort, but
+//only the first k elements of a run can make it into the answer, so just those are moved
+//to a zone after begin and merged there. Once the zone holds 2k elements it is merged
+//down to k, and from then on the k-th smallest so far bounds the input: an element above
+//it costs one comparison, and the few below it that come in short runs are gathered and
+//sorted minrun at a time. A presorted input takes O(n + k log k)
+template <class RandomAccessIterator, class Compare, class Params>
+void timPartialSort(RandomAccessIterator begin, RandomAccessIterator middle, RandomAccessIterator end,
+        Compare comp, const Params &params) {
+    size_t k = middle - begin;
+    if (k == 0) {
+        return;
+    }
+
+    //the pruning cannot pay off when most of the range is wanted
+    if (2 * k >= static_cast<size_t>(end - begin)) {
+        timSort(begin, end, comp, params);
+        return;
+    }
+
+    RunStack<RandomAccessIterator> runs(begin, end - begin);
+    MergeBuffer<RandomAccessIterator> buffer;
+    size_t minrun = params.minRun(end - begin);
+
+    RandomAccessIterator zoneEnd = begin;
+    //unsorted candidates right after the zone
+    size_t pending = 0;
+    //[begin, middle) holds the k smallest elements seen so far, in order
+    bool isBounded = false;
+
+    for (RandomAccessIterator runBegin = begin; runBegin != end;) {
+        //an element not below the k-th smallest so far cannot make it, whatever its run
+        if (isBounded) {
+            while (runBegin != end && !comp(*runBegin, *(middle - 1))) {
+                ++runBegin;
+            }
+            if (runBegin == end) {
+                break;
+            }
+        }
+
+        bool isDescending;
+        RandomAccessIterator runEnd = findRunEnd(runBegin, end, comp, isDescending);
+
+        if (isDescending) {
+            //the k smallest of a descending run are its tail, the rest need not be reversed
+            if (static_cast<size_t>(runEnd - runBegin) > k) {
+                runBegin = runEnd - k;
+            }
+            reverseBlock(runBegin, runEnd);
+            recordMoves(comp, 3 * ((runEnd - runBegin) / 2));
+        }
+
+        if (isBounded && static_cast<size_t>(runEnd - runBegin) < minrun) {
+            RandomAccessIterator candidatesEnd = gallopLeft(runBegin, runEnd, *(middle - 1), comp);
+            moveCandidates(zoneEnd + pending, runBegin, candidatesEnd - runBegin, comp);
+            pending += candidatesEnd - runBegin;
+
+            if (pending >= minrun) {
+                pushPendingRun(runs, zoneEnd, pending, comp, params, buffer);
+            }
+        } else {
+            pushPendingRun(runs, zoneEnd, pending, comp, params, buffer);
+
+            RandomAccessIterator naturalEnd = runEnd;
+            while (runEnd != end && static_cast<size_t>(runEnd - runBegin) < minrun) {
+                ++runEnd;
+            }
+
+            binaryInsertionSort(runBegin, naturalEnd, runEnd, comp);
+            recordRun(comp, naturalEnd - runBegin, runEnd - runBegin);
+
+            RandomAccessIterator candidatesEnd = (static_cast<size_t>(runEnd - runBegin) > k) ? runBegin + k : runEnd;
+            if (isBounded) {
+                candidatesEnd = gallopLeft(runBegin, candidatesEnd, *(middle - 1), comp);
+            }
+
+            size_t count = candidatesEnd - runBegin;
+            if (count > 0) {
+                moveCandidates(zoneEnd, runBegin, count, comp);
+                pushZoneRun(runs, zoneEnd, count, comp, params, buffer);
+                zoneEnd += count;
+            }
+        }
+
+        runBegin = runEnd;
+
+        if (static_cast<size_t>(zoneEnd - begin) + pending >= 2 * k) {
+            pushPendingRun(runs, zoneEnd, pending, comp, params, buffer);
+            mergeRuns(runs, comp, params, buffer);
+
+            runs = RunStack<RandomAccessIterator>(begin, end - begin);
+            runs.emplace(begin, k);
+            zoneEnd = middle;
+            isBounded = true;
+        }
+    }
+
+    pushPendingRun(runs, zoneEnd, pending, comp, params, buffer);
+    mergeRuns(runs, comp, params, buffer);
+}
+
+template <class RandomAccessIterator, class Compare>
+typename std::enable_if<!IsTimSortPolicy<Compare>::value>::type
+timPartialSort(RandomAccessIterator begin, RandomAccessIterator middle, RandomAccessIterator end,
+        Compare comp) {
+    timPartialSort(begin, middle, end, comp, DefaultParams());
+}
+
+template <class RandomAccessIterator>
+void timPartialSort(RandomAccessIterator begin, RandomAccessIterator middle, RandomAccessIterator end) {
+    typedef typename std::iterator_traits<RandomAccessIterator>::value_type ValueType;
+    timPartialSort(begin, middle, end, LessCompare<ValueType>(), DefaultParams());
+}
+
+//the k smallest elements of [begin, end) in order; the range itself is left untouched
+template <class RandomAccessIterator, class Compare, class Params>
+std::vector<typename std::iterator_traits<RandomAccessIterator>::value_type>
+timTopK(RandomAccessIterator begin, RandomAccessIterator end, size_t k, Compare comp, const Params &params) {
+    typedef typename std::iterator_traits<RandomAccessIterator>::value_type ValueType;
+
+    std::vector<ValueType> values(begin, end);
+    if (k > values.size()) {
+        k = values.size();
+    }
+
+    timPartialSort(values.begin(), values.begin() + k, values.end(), comp, params);
+    values.erase(values.begin() + k, values.end());
+
+    return values;
+}
+
+template <class RandomAccessIterator, class Compare>
+typename std::enable_if<!IsTimSortPolicy<Compare>::value,
+        std::vector<typename std::iterator_traits<RandomAccessIterator>::value_type>>::type
+timTopK(RandomAccessIterator begin, RandomAccessIterator end, size_t k, Compare comp) {
+    return timTopK(begin, end, k, comp, DefaultParams());
+}
+
+template <class RandomAccessIterator>
+std::vector<typename std::iterator_traits<RandomAccessIterator>::value_type>
+timTopK(RandomAccessIterator begin, RandomAccessIterator end, size_t k) {
+    typedef typename std::iterator_traits<RandomAccessIterator>::value_type ValueType;
+    return timTopK(begin, end, k, LessCompare<ValueType>(), DefaultParams());
+}
+
+#endif
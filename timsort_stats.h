@@ -0,0 +1,143 @@
+#pragma once
+
+#ifndef TIMSORT_STATS_H
+#define TIMSORT_STATS_H
+
+//counters of a single timSort call; not synchronized, so collect them with a policy
+//that does not merge in parallel
+struct TimSortStats {
+    static const ui32 histogramSize = 64;
+
+    size_t comparisons;
+    size_t moves;
+
+    size_t runs;
+    //runs by floor(log2(natural length))
+    size_t runLengthHistogram[histogramSize];
+    size_t naturalRuns;
+    size_t paddedRuns;
+    size_t paddedElements;
+
+    //indexed by EWhatMerge, WM_NoMerge counts the merges of the final collapse
+    size_t merges[3];
+    size_t inplaceMerges;
+    size_t bufferedMerges;
+
+    size_t gallops;
+    size_t gallopSkipped;
+
+    //sorts that went to the radix path instead of the merge engine
+    size_t radixSorts;
+
+    TimSortStats() {
+        reset();
+    }
+
+    void reset() {
+        comparisons = moves = 0;
+        runs = naturalRuns = paddedRuns = paddedElements = 0;
+        for (ui32 bucket = 0; bucket < histogramSize; ++bucket) {
+            runLengthHistogram[bucket] = 0;
+        }
+        merges[WM_NoMerge] = merges[WM_MergeXY] = merges[WM_MergeYZ] = 0;
+        inplaceMerges = bufferedMerges = 0;
+        gallops = gallopSkipped = 0;
+        radixSorts = 0;
+    }
+};
+
+//comparator that counts its calls; the engine reports the other counters
+//through the record* hooks, which do nothing for any other comparator. The vector
+//run detection and the radix path accept it like the comparator it wraps, so the
+//counters describe the path an unwrapped sort takes
+template <class Compare>
+struct StatsCompare {
+    Compare comp;
+    TimSortStats *stats;
+
+    StatsCompare(Compare comp, TimSortStats *stats) : comp(comp), stats(stats) {}
+
+    template <class First, class Second>
+    bool operator()(const First &first, const Second &second) {
+        ++stats->comparisons;
+        return comp(first, second);
+    }
+};
+
+template <class Compare>
+inline void recordRun(const Compare &, size_t, size_t) {}
+
+template <class Compare>
+inline void recordRun(const StatsCompare<Compare> &comp, size_t naturalLength, size_t length) {
+    TimSortStats &stats = *comp.stats;
+
+    ++stats.runs;
+    ui32 bucket = 0;
+    while ((naturalLength >> bucket) > 1) {
+        ++bucket;
+    }
+    ++stats.runLengthHistogram[bucket];
+
+    if (length > naturalLength) {
+        ++stats.paddedRuns;
+        stats.paddedElements += length - naturalLength;
+    } else {
+        ++stats.naturalRuns;
+    }
+}
+
+template <class Compare>
+inline void recordMerge(const Compare &, EWhatMerge) {}
+
+template <class Compare>
+inline void recordMerge(const StatsCompare<Compare> &comp, EWhatMerge whatMerge) {
+    ++comp.stats->merges[whatMerge];
+}
+
+template <class Compare>
+inline void recordMergeMode(const Compare &, EMergeMode) {}
+
+template <class Compare>
+inline void recordMergeMode(const StatsCompare<Compare> &comp, EMergeMode mergeMode) {
+    if (mergeMode != MM_Buffered) {
+        ++comp.stats->inplaceMerges;
+    } else {
+        ++comp.stats->bufferedMerges;
+    }
+}
+
+template <class Compare>
+inline void recordGallop(const Compare &, size_t) {}
+
+template <class Compare>
+inline void recordGallop(const StatsCompare<Compare> &comp, size_t skipped) {
+    ++comp.stats->gallops;
+    comp.stats->gallopSkipped += skipped;
+}
+
+template <class Compare>
+inline void recordComparisons(const Compare &, size_t) {}
+
+//comparisons made without calling comp, by the vector run detection
+template <class Compare>
+inline void recordComparisons(const StatsCompare<Compare> &comp, size_t comparisons) {
+    comp.stats->comparisons += comparisons;
+}
+
+template <class Compare>
+inline void recordRadixSort(const Compare &) {}
+
+template <class Compare>
+inline void recordRadixSort(const StatsCompare<Compare> &comp) {
+    ++comp.stats->radixSorts;
+}
+
+template <class Compare>
+inline void recordMoves(const Compare &, size_t) {}
+
+template <class Compare>
+inline void recordMoves(const StatsCompare<Compare> &comp, size_t moves) {
+    comp.stats->moves += moves;
+}
+
+#endif